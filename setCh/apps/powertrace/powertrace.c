@@ -42,6 +42,10 @@
 #include "sys/compower.h"
 #include "powertrace.h"
 #include "net/rime.h"
+#include "net/mac/csma.h"
+#include "net/mac/contikimac.h"
+#include "net/mac/phase.h"
+#include "net/mac/radio-channel.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -188,9 +192,58 @@ powertrace_print(char *str)
     s->last_output_rxtime = s->output_rxtime;
     
   }
+
+#if ENERGEST_CHANNELS
+  powertrace_print_channels(str, seqno);
+#endif /* ENERGEST_CHANNELS */
   seqno++;
 }
 /*---------------------------------------------------------------------------*/
+/* One PC line per channel the radio has been on: transmit, listen and
+   receive time since boot. The PS line gives the number of channel
+   switches, the time they took, the switches that CSMA channel
+   grouping saved and the retunes of the spectrum survey, which are
+   not among the switches. The PM line gives the multichannel MAC
+   counters: broadcasts replicated and sent over a rendezvous, unicast
+   copies and the broadcast airtime, phase hits, misses, channel
+   changes and drops, and channel changes asked of the radio and those
+   skipped because it was already there. All times are cumulative, in
+   rtimer ticks. */
+void
+powertrace_print_channels(char *str, uint32_t seqno)
+{
+  int c;
+  unsigned long transmit, listen, receive;
+
+  for(c = ENERGEST_CHANNEL_FIRST;
+      c < ENERGEST_CHANNEL_FIRST + ENERGEST_CHANNEL_NUM; c++) {
+    transmit = energest_channel_time(ENERGEST_CHANNEL_TRANSMIT, c);
+    listen = energest_channel_time(ENERGEST_CHANNEL_LISTEN, c);
+    receive = energest_channel_time(ENERGEST_CHANNEL_RECEIVE, c);
+    if(transmit == 0 && listen == 0) {
+      continue;
+    }
+    printf("%s %lu PC %d.%d %lu %d %lu %lu %lu\n",
+           str, clock_time(), rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+           (unsigned long)seqno, c, transmit, listen, receive);
+  }
+  printf("%s %lu PS %d.%d %lu %lu %lu %lu %lu\n",
+         str, clock_time(), rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+         (unsigned long)seqno, energest_channel_switches(),
+         energest_channel_settle_time(), csma_channel_switches_avoided(),
+         energest_channel_survey_switches());
+  printf("%s %lu PM %d.%d %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+         str, clock_time(), rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+         (unsigned long)seqno,
+         contikimac_broadcast_stats.replicated,
+         contikimac_broadcast_stats.rendezvous,
+         contikimac_broadcast_stats.copies,
+         contikimac_broadcast_stats.airtime,
+         phase_stats.hits, phase_stats.misses,
+         phase_stats.channel_changes, phase_stats.drops,
+         radio_channel_stats.requests, radio_channel_stats.skipped);
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(powertrace_process, ev, data)
 {
   static struct etimer periodic;
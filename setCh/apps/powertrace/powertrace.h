@@ -53,5 +53,8 @@ typedef enum {
 void powertrace_sniff(powertrace_onoff_t onoff);
 
 void powertrace_print(char *str);
+/* Per-channel radio time, printed by powertrace_print() when
+   ENERGEST_CONF_CHANNELS is set */
+void powertrace_print_channels(char *str, uint32_t seqno);
 
 #endif /* POWERTRACE_H */
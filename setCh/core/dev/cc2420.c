@@ -148,18 +148,25 @@ const struct radio_driver cc2420_driver =
     cc2420_transmit,
     cc2420_send,
     cc2420_read,
-    /* cc2420_set_channel, */
     /* detected_energy, */
     cc2420_cca,
     cc2420_receiving_packet,
     pending_packet,
     cc2420_on,
     cc2420_off,
+    cc2420_set_channel,
+    cc2420_get_channel,
   };
 
 static uint8_t receive_on;
 
+/* The channel asked for, and the one the synthesizer is tuned to. While
+   the radio is off a new channel is only recorded, and tuned to when
+   the radio next listens or transmits. */
 static int channel;
+static int tuned_channel;
+
+static void tune(void);
 
 /*---------------------------------------------------------------------------*/
 
@@ -202,6 +209,7 @@ static uint8_t locked, lock_on, lock_off;
 static void
 on(void)
 {
+  tune();
   CC2420_ENABLE_FIFOP_INT();
   strobe(CC2420_SRXON);
 
@@ -267,6 +275,46 @@ set_txpower(uint8_t power)
   setreg(CC2420_TXCTRL, reg);
 }
 /*---------------------------------------------------------------------------*/
+/* Call with the lock held */
+static void
+tune(void)
+{
+  uint16_t f;
+#if ENERGEST_CONF_ON && ENERGEST_CHANNELS
+  rtimer_clock_t start;
+
+  start = RTIMER_NOW();
+#endif /* ENERGEST_CONF_ON && ENERGEST_CHANNELS */
+
+  if(channel == tuned_channel) {
+    return;
+  }
+
+  /*
+   * Subtract the base channel (11), multiply by 5, which is the
+   * channel spacing. 357 is 2405-2048 and 0x4000 is LOCK_THR = 1.
+   */
+  f = 5 * (channel - 11) + 357 + 0x4000;
+  /*
+   * Writing RAM requires crystal oscillator to be stable.
+   */
+  BUSYWAIT_UNTIL((status() & (BV(CC2420_XOSC16M_STABLE))), RTIMER_SECOND / 10);
+
+  /* Wait for any transmission to end. */
+  BUSYWAIT_UNTIL(!(status() & BV(CC2420_TX_ACTIVE)), RTIMER_SECOND / 10);
+
+  setreg(CC2420_FSCTRL, f);
+  tuned_channel = channel;
+
+  /* If we are in receive mode, we issue an SRXON command to ensure
+     that the VCO is calibrated. */
+  if(receive_on) {
+    strobe(CC2420_SRXON);
+  }
+
+  ENERGEST_CHANNEL_SWITCH(channel, RTIMER_NOW() - start);
+}
+/*---------------------------------------------------------------------------*/
 #define AUTOACK (1 << 4)
 #define ADR_DECODE (1 << 11)
 #define RXFIFO_PROTECTION (1 << 9)
@@ -335,6 +383,7 @@ cc2420_init(void)
 
   flushrx();
 
+  process_set_priority(&cc2420_process, PROCESS_PRIORITY_HIGH);
   process_start(&cc2420_process, NULL);
   return 1;
 }
@@ -350,6 +399,8 @@ cc2420_transmit(unsigned short payload_len)
 
   GET_LOCK();
 
+  tune();
+
   txpower = 0;
   if(packetbuf_attr(PACKETBUF_ATTR_RADIO_TXPOWER) > 0) {
     /* Remember the current transmission power */
@@ -539,33 +590,15 @@ cc2420_get_channel(void)
 int
 cc2420_set_channel(int c)
 {
-  uint16_t f;
-
-  GET_LOCK();
-  /*
-   * Subtract the base channel (11), multiply by 5, which is the
-   * channel spacing. 357 is 2405-2048 and 0x4000 is LOCK_THR = 1.
-   */
   channel = c;
 
-  f = 5 * (c - 11) + 357 + 0x4000;
-  /*
-   * Writing RAM requires crystal oscillator to be stable.
-   */
-  BUSYWAIT_UNTIL((status() & (BV(CC2420_XOSC16M_STABLE))), RTIMER_SECOND / 10);
-
-  /* Wait for any transmission to end. */
-  BUSYWAIT_UNTIL(!(status() & BV(CC2420_TX_ACTIVE)), RTIMER_SECOND / 10);
-
-  setreg(CC2420_FSCTRL, f);
-
-  /* If we are in receive mode, we issue an SRXON command to ensure
-     that the VCO is calibrated. */
+  /* A radio that is off is tuned when it is next used, so switching
+     out and back while it sleeps costs nothing */
   if(receive_on) {
-    strobe(CC2420_SRXON);
+    GET_LOCK();
+    tune();
+    RELEASE_LOCK();
   }
-
-  RELEASE_LOCK();
   return 1;
 }
 /*---------------------------------------------------------------------------*/
@@ -728,6 +761,9 @@ cc2420_read(void *buf, unsigned short bufsize)
 
     packetbuf_set_attr(PACKETBUF_ATTR_RSSI, cc2420_last_rssi);
     packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, cc2420_last_correlation);
+    packetbuf_set_attr(PACKETBUF_ATTR_RX_CHANNEL, tuned_channel);
+    /* Preamble, SFD and length byte go on air before the frame */
+    ENERGEST_CHANNEL_RECEIVE(len + 6);
 
     RIMESTATS_ADD(llrx);
 
@@ -787,6 +823,7 @@ cc2420_rssi(void)
   
   GET_LOCK();
 
+  tune();
   if(!receive_on) {
     radio_was_off = 1;
     cc2420_on();
@@ -838,6 +875,7 @@ cc2420_cca(void)
   }
 
   GET_LOCK();
+  tune();
   if(!receive_on) {
     radio_was_off = 1;
     cc2420_on();
@@ -44,14 +44,29 @@
  * Author: Adam Dunkels <adam@sics.se>
  *
  */
+#include "contiki-conf.h"
 #include "lib/list.h"
 
+#ifndef NULL
 #define NULL 0
+#endif
 
 struct list {
   struct list *next;
 };
 
+/* With LIST_CONF_DEBUG, list_tail_add() and list_tail_push() make sure
+   that an item is not added twice, at the cost of a scan of the list. */
+#ifdef LIST_CONF_DEBUG
+#define LIST_DEBUG LIST_CONF_DEBUG
+#else
+#define LIST_DEBUG 0
+#endif
+
+/* A list declared with LIST_TAIL() points to two pointers: the first
+   element and the last element. */
+#define TAIL(list) (list)[1]
+
 /*---------------------------------------------------------------------------*/
 /**
  * Initialize a list.
@@ -326,4 +341,121 @@ list_item_next(void *item)
   return item == NULL? NULL: ((struct list *)item)->next;
 }
 /*---------------------------------------------------------------------------*/
+/**
+ * Initialize a list declared with LIST_TAIL().
+ *
+ * \param list The list to be initialized.
+ */
+void
+list_tail_init(list_t list)
+{
+  *list = NULL;
+  TAIL(list) = NULL;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get the last element of a list declared with LIST_TAIL(), in
+ * constant time.
+ *
+ * \param list The list.
+ */
+void *
+list_tail_last(list_t list)
+{
+  return TAIL(list);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Add an item at the end of a list declared with LIST_TAIL(), in
+ * constant time.
+ *
+ * \param list The list.
+ * \param item A pointer to the item to be added.
+ */
+void
+list_tail_add(list_t list, void *item)
+{
+#if LIST_DEBUG
+  list_tail_remove(list, item);
+#endif
+
+  ((struct list *)item)->next = NULL;
+
+  if(TAIL(list) == NULL) {
+    *list = item;
+  } else {
+    ((struct list *)TAIL(list))->next = item;
+  }
+  TAIL(list) = item;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Add an item to the start of a list declared with LIST_TAIL().
+ *
+ * \param list The list.
+ * \param item A pointer to the item to be pushed on the list.
+ */
+void
+list_tail_push(list_t list, void *item)
+{
+#if LIST_DEBUG
+  list_tail_remove(list, item);
+#endif
+
+  ((struct list *)item)->next = *list;
+  *list = item;
+  if(TAIL(list) == NULL) {
+    TAIL(list) = item;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Remove the first object on a list declared with LIST_TAIL().
+ *
+ * \param list The list.
+ * \return The removed object
+ */
+void *
+list_tail_pop(list_t list)
+{
+  struct list *l;
+
+  l = list_pop(list);
+  if(*list == NULL) {
+    TAIL(list) = NULL;
+  }
+
+  return l;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Remove a specific element from a list declared with LIST_TAIL().
+ * Removing the first element takes constant time.
+ *
+ * \param list The list.
+ * \param item The item that is to be removed from the list.
+ */
+void
+list_tail_remove(list_t list, void *item)
+{
+  struct list *l, *r;
+
+  r = NULL;
+  for(l = *list; l != NULL; l = l->next) {
+    if(l == item) {
+      if(r == NULL) {
+	*list = l->next;
+      } else {
+	r->next = l->next;
+      }
+      if(TAIL(list) == l) {
+	TAIL(list) = r;
+      }
+      l->next = NULL;
+      return;
+    }
+    r = l;
+  }
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
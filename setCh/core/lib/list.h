@@ -128,6 +128,48 @@
        list_init((struct_ptr)->name);                                   \
     } while(0)
 
+/**
+ * Declare a linked list that also keeps a pointer to its last element.
+ *
+ * A list declared with LIST_TAIL() must only be modified with the
+ * list_tail_*() functions, which append, push and pop in constant
+ * time. It can be read with list_head(), list_item_next() and
+ * list_length() like any other list.
+ *
+ * Unlike list_add() and list_push(), list_tail_add() and
+ * list_tail_push() do not check if the item already is on the list:
+ * adding it twice corrupts the list. With LIST_CONF_DEBUG set to 1 they
+ * do the same check as list_add() and list_push().
+ *
+ * \param name The name of the list.
+ */
+#define LIST_TAIL(name) \
+         static void *LIST_CONCAT(name,_list)[2] = { NULL, NULL }; \
+         static list_t name = (list_t)LIST_CONCAT(name,_list)
+
+/**
+ * Declare a linked list with a tail pointer inside a structure
+ * declaration. The list is initialized with LIST_TAIL_STRUCT_INIT().
+ *
+ * \param name The name of the list.
+ */
+#define LIST_TAIL_STRUCT(name) \
+         void *LIST_CONCAT(name,_list)[2]; \
+         list_t name
+
+/**
+ * Initialize a linked list with a tail pointer that is part of a
+ * structure.
+ *
+ * \param struct_ptr A pointer to the struct
+ * \param name The name of the list.
+ */
+#define LIST_TAIL_STRUCT_INIT(struct_ptr, name)                         \
+    do {                                                                \
+       (struct_ptr)->name = (struct_ptr)->LIST_CONCAT(name,_list);      \
+       list_tail_init((struct_ptr)->name);                              \
+    } while(0)
+
 /**
  * The linked list type.
  *
@@ -153,6 +195,13 @@ void   list_insert(list_t list, void *previtem, void *newitem);
 
 void * list_item_next(void *item);
 
+void   list_tail_init(list_t list);
+void * list_tail_last(list_t list);
+void   list_tail_add(list_t list, void *item);
+void   list_tail_push(list_t list, void *item);
+void * list_tail_pop(list_t list);
+void   list_tail_remove(list_t list, void *item);
+
 #endif /* __LIST_H__ */
 
 /** @} */
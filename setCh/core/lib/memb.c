@@ -53,6 +53,11 @@ memb_init(struct memb *m)
 {
   memset(m->count, 0, m->num);
   memset(m->mem, 0, m->size * m->num);
+
+  if(m->next != NULL) {
+    memset(m->next, 0, m->num * sizeof(m->next[0]));
+    m->free = 0;
+  }
 }
 /*---------------------------------------------------------------------------*/
 void *
@@ -60,6 +65,17 @@ memb_alloc(struct memb *m)
 {
   int i;
 
+  if(m->next != NULL) {
+    /* Take the first block off the free list. */
+    if(m->free >= m->num) {
+      return NULL;
+    }
+    i = m->free;
+    m->free = m->next[i] == 0 ? i + 1 : m->next[i] - 1;
+    ++(m->count[i]);
+    return (void *)((char *)m->mem + (i * m->size));
+  }
+
   for(i = 0; i < m->num; ++i) {
     if(m->count[i] == 0) {
       /* If this block was unused, we increase the reference count to
@@ -81,6 +97,24 @@ memb_free(struct memb *m, void *ptr)
   int i;
   char *ptr2;
 
+  if(m->next != NULL) {
+    if(!memb_inmemb(m, ptr) ||
+       ((char *)ptr - (char *)m->mem) % m->size != 0) {
+      return -1;
+    }
+    i = ((char *)ptr - (char *)m->mem) / m->size;
+    if(m->count[i] > 0) {
+      /* Make sure that we don't deallocate free memory. */
+      --(m->count[i]);
+      if(m->count[i] == 0) {
+	/* Put the block back first on the free list. */
+	m->next[i] = m->free + 1;
+	m->free = i;
+      }
+    }
+    return m->count[i];
+  }
+
   /* Walk through the list of blocks and try to find the block to
      which the pointer "ptr" points to. */
   ptr2 = (char *)m->mem;
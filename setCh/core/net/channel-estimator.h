@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Per-neighbor, per-channel link estimator. Keeps EWMA estimates
+ *         of ETX, PRR, RSSI and LQI for every channel a neighbor has been
+ *         reached or heard on, and ranks channels by link quality.
+ */
+
+#ifndef CHANNEL_ESTIMATOR_H
+#define CHANNEL_ESTIMATOR_H
+
+#include "net/rime/rimeaddr.h"
+
+#define CHANNEL_ESTIMATOR_FIRST_CHANNEL 11
+#define CHANNEL_ESTIMATOR_LAST_CHANNEL  26
+#define CHANNEL_ESTIMATOR_NUM_CHANNELS  (CHANNEL_ESTIMATOR_LAST_CHANNEL - \
+                                         CHANNEL_ESTIMATOR_FIRST_CHANNEL + 1)
+
+/* ETX is kept in sixteenths, PRR in 1/255 */
+#define CHANNEL_ESTIMATOR_ETX_DIVISOR 16
+#define CHANNEL_ESTIMATOR_PRR_MAX     255
+
+/* Keep the per-neighbor tables on the node (the estimate helpers below
+   are always available, e.g. for the LPBR) */
+#ifdef CHANNEL_ESTIMATOR_CONF_ENABLED
+#define CHANNEL_ESTIMATOR_ENABLED CHANNEL_ESTIMATOR_CONF_ENABLED
+#else
+#define CHANNEL_ESTIMATOR_ENABLED 1
+#endif
+
+/* PRR below which channel_estimator_usable() rejects a channel, by
+   default six out of eight probes */
+#ifdef CHANNEL_ESTIMATOR_CONF_USABLE_PRR
+#define CHANNEL_ESTIMATOR_USABLE_PRR CHANNEL_ESTIMATOR_CONF_USABLE_PRR
+#else
+#define CHANNEL_ESTIMATOR_USABLE_PRR 191
+#endif
+
+struct channel_estimate {
+  uint8_t etx;
+  uint8_t prr;
+  int8_t rssi;
+  uint8_t lqi;
+  uint8_t samples;
+};
+
+/* Fold one sample into a single estimate */
+void channel_estimate_init(struct channel_estimate *e);
+void channel_estimate_tx(struct channel_estimate *e, int status,
+                         int num_transmissions);
+void channel_estimate_rx(struct channel_estimate *e, int8_t rssi, uint8_t lqi);
+void channel_estimate_probe(struct channel_estimate *e, uint8_t received,
+                            uint8_t sent);
+
+/* Higher is better, 0..CHANNEL_ESTIMATOR_PRR_MAX */
+uint8_t channel_estimate_score(const struct channel_estimate *e);
+
+/* Fill channels[] with up to max channels ordered best first, given one
+   estimate per channel starting at CHANNEL_ESTIMATOR_FIRST_CHANNEL.
+   Returns the number of channels written. */
+int channel_estimate_rank(const struct channel_estimate *estimates,
+                          uint8_t *channels, int max);
+
+/* Per-neighbor estimates kept by the node */
+void channel_estimator_init(void);
+void channel_estimator_tx(const rimeaddr_t *dest, uint8_t channel,
+                          int status, int num_transmissions);
+void channel_estimator_rx(const rimeaddr_t *src, uint8_t channel);
+void channel_estimator_probe(const rimeaddr_t *nbr, uint8_t channel,
+                             uint8_t received, uint8_t sent);
+const struct channel_estimate *channel_estimator_get(const rimeaddr_t *nbr,
+                                                     uint8_t channel);
+
+/* Channels ranked over all neighbors, best first */
+int channel_estimator_rank(uint8_t *channels, int max);
+/* Non-zero if the average PRR towards the neighbors on channel is at
+   least CHANNEL_ESTIMATOR_USABLE_PRR */
+int channel_estimator_usable(uint8_t channel);
+
+#endif /* CHANNEL_ESTIMATOR_H */
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Compact on-air encoding of the multichannel control messages
+ */
+
+#include "net/channel-msg.h"
+
+#include <string.h>
+
+/* Field tags, the length byte follows the tag */
+#define TAG_VALUE       1
+#define TAG_VALUE2      2
+#define TAG_ADDR_LL     3 /* fe80::/64 and the interface identifier */
+#define TAG_ADDR_PREFIX 4 /* CHANNEL_MSG_PREFIX and the interface identifier */
+#define TAG_ADDR        5 /* any other address in full */
+#define TAG_TIME        6 /* two bytes, most significant first */
+#define TAG_SURVEY      7 /* packed spectrum survey, one byte per channel */
+
+/* CHANNEL_MSG_PREFIX is a list of four words, expand it before use */
+#define prefix_set(addr, p0, p1, p2, p3) \
+  uip_ip6addr(addr, p0, p1, p2, p3, 0, 0, 0, 0)
+#define channel_msg_prefix(addr, prefix) prefix_set(addr, prefix)
+
+#define HAS_VALUE   0x01
+#define HAS_VALUE2  0x02
+#define HAS_ADDRESS 0x04
+#define HAS_TIME    0x08
+#define HAS_SURVEY  0x10
+
+/* The fields each message type carries */
+static const uint8_t fields[CHANNEL_MSG_NUM_TYPES] = {
+  HAS_VALUE,                            /* CH_CHANGE */
+  HAS_VALUE,                            /* NBR_CH_CHANGE */
+  HAS_VALUE,                            /* STARTPROBE */
+  HAS_VALUE | HAS_VALUE2,               /* NBRPROBE */
+  HAS_VALUE | HAS_VALUE2 | HAS_ADDRESS, /* PROBERESULT */
+  HAS_VALUE | HAS_VALUE2,               /* CONFIRM_CH */
+  HAS_VALUE,                            /* GET_ACK */
+  HAS_VALUE | HAS_VALUE2,               /* SENTRECV */
+  HAS_ADDRESS,                          /* SEND_NBR */
+  HAS_VALUE,                            /* SEND_CH */
+  HAS_VALUE | HAS_VALUE2 | HAS_ADDRESS, /* CH_REQUEST */
+  HAS_VALUE | HAS_TIME,                 /* CH_SCHEDULE */
+  HAS_VALUE | HAS_TIME,                 /* NBR_CH_SCHEDULE */
+  HAS_VALUE,                            /* SCHEDULE_ACK */
+  HAS_VALUE,                            /* CH_ABORT */
+  HAS_SURVEY,                           /* SURVEY */
+  HAS_VALUE,                            /* SCHEDULE_NACK */
+};
+/*---------------------------------------------------------------------------*/
+static uint8_t
+message_fields(const struct channel_msg *msg)
+{
+  if(msg->type >= CHANNEL_MSG_NUM_TYPES) {
+    return HAS_VALUE | HAS_VALUE2 | HAS_ADDRESS;
+  }
+  return fields[msg->type];
+}
+/*---------------------------------------------------------------------------*/
+static int
+put_field(uint8_t *buf, int pos, int size,
+          uint8_t tag, const uint8_t *value, uint8_t len)
+{
+  if(pos + 2 + len > size) {
+    return 0;
+  }
+  buf[pos] = tag;
+  buf[pos + 1] = len;
+  memcpy(&buf[pos + 2], value, len);
+  return pos + 2 + len;
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_msg_encode(uint8_t *buf, int size, const struct channel_msg *msg)
+{
+  uip_ipaddr_t prefix;
+  uint8_t time[2];
+  uint8_t has;
+  int pos;
+
+  if(size < 2) {
+    return 0;
+  }
+  buf[0] = CHANNEL_MSG_DISPATCH | CHANNEL_MSG_VERSION;
+  buf[1] = msg->type;
+  pos = 2;
+
+  has = message_fields(msg);
+
+  if((has & HAS_VALUE) && msg->value != 0) {
+    pos = put_field(buf, pos, size, TAG_VALUE, &msg->value, 1);
+    if(pos == 0) {
+      return 0;
+    }
+  }
+  if((has & HAS_VALUE2) && msg->value2 != 0) {
+    pos = put_field(buf, pos, size, TAG_VALUE2, &msg->value2, 1);
+    if(pos == 0) {
+      return 0;
+    }
+  }
+  if((has & HAS_TIME) && msg->time != 0) {
+    time[0] = msg->time >> 8;
+    time[1] = msg->time & 0xff;
+    pos = put_field(buf, pos, size, TAG_TIME, time, 2);
+    if(pos == 0) {
+      return 0;
+    }
+  }
+  if((has & HAS_SURVEY) && msg->survey_len == SPECTRUM_SURVEY_REPORT_LEN) {
+    pos = put_field(buf, pos, size, TAG_SURVEY, msg->survey,
+                    SPECTRUM_SURVEY_REPORT_LEN);
+    if(pos == 0) {
+      return 0;
+    }
+  }
+  if((has & HAS_ADDRESS) && !uip_is_addr_unspecified(&msg->address)) {
+    channel_msg_prefix(&prefix, CHANNEL_MSG_PREFIX);
+    if(uip_is_addr_link_local(&msg->address)) {
+      pos = put_field(buf, pos, size, TAG_ADDR_LL, &msg->address.u8[8], 8);
+    } else if(uip_ipaddr_prefixcmp(&msg->address, &prefix, 64)) {
+      pos = put_field(buf, pos, size, TAG_ADDR_PREFIX, &msg->address.u8[8], 8);
+    } else {
+      pos = put_field(buf, pos, size, TAG_ADDR, msg->address.u8, 16);
+    }
+  }
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_msg_decode(struct channel_msg *msg, const uint8_t *buf, int len)
+{
+  uint8_t tag;
+  uint8_t flen;
+  int pos;
+
+  memset(msg, 0, sizeof(*msg));
+  msg->type = CHANNEL_MSG_NONE;
+
+  if(len < 2 || buf[0] != (CHANNEL_MSG_DISPATCH | CHANNEL_MSG_VERSION)) {
+    return 0;
+  }
+
+  for(pos = 2; pos < len; pos += 2 + flen) {
+    if(pos + 2 > len) {
+      return 0;
+    }
+    tag = buf[pos];
+    flen = buf[pos + 1];
+    if(pos + 2 + flen > len) {
+      return 0;
+    }
+    switch(tag) {
+    case TAG_VALUE:
+      if(flen == 1) {
+        msg->value = buf[pos + 2];
+      }
+      break;
+    case TAG_VALUE2:
+      if(flen == 1) {
+        msg->value2 = buf[pos + 2];
+      }
+      break;
+    case TAG_ADDR_LL:
+      if(flen == 8) {
+        uip_create_linklocal_prefix(&msg->address);
+        memcpy(&msg->address.u8[8], &buf[pos + 2], 8);
+      }
+      break;
+    case TAG_ADDR_PREFIX:
+      if(flen == 8) {
+        channel_msg_prefix(&msg->address, CHANNEL_MSG_PREFIX);
+        memcpy(&msg->address.u8[8], &buf[pos + 2], 8);
+      }
+      break;
+    case TAG_ADDR:
+      if(flen == 16) {
+        memcpy(msg->address.u8, &buf[pos + 2], 16);
+      }
+      break;
+    case TAG_TIME:
+      if(flen == 2) {
+        msg->time = (buf[pos + 2] << 8) | buf[pos + 3];
+      }
+      break;
+    case TAG_SURVEY:
+      if(flen == SPECTRUM_SURVEY_REPORT_LEN) {
+        memcpy(msg->survey, &buf[pos + 2], flen);
+        msg->survey_len = flen;
+      }
+      break;
+    default:
+      /* A field of a later version of this message */
+      break;
+    }
+  }
+
+  msg->type = buf[1];
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Scheduled channel switches
+ */
+
+#include "net/channel-switch.h"
+#include "net/uip-ds6.h"
+#include "net/nbr-table.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+#include "sys/ctimer.h"
+
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+struct nbr_switch {
+  struct nbr_switch *next;
+  uip_ipaddr_t addr;
+  uint8_t channel;
+  struct ctimer timer;
+};
+
+LIST(nbr_switch_list);
+MEMB(nbr_switch_memb, struct nbr_switch, CHANNEL_SWITCH_MAX_PENDING);
+
+/* The neighbors that acked our pending switch. Without the table acks
+   are counted as they come. */
+NBR_TABLE(uint8_t, acked);
+static uint8_t acked_registered;
+
+process_event_t channel_switch_event;
+
+static struct process *notify;
+
+static struct {
+  uint8_t pending;
+  uint8_t channel;
+  uint8_t neighbors;
+  uint8_t acks;
+  clock_time_t activation;
+  struct ctimer timer;
+} own;
+/*---------------------------------------------------------------------------*/
+static void
+post(uint8_t result, uint8_t channel, const uip_ipaddr_t *addr)
+{
+  struct channel_switch_info info;
+
+  info.result = result;
+  info.channel = channel;
+  if(addr != NULL) {
+    uip_ipaddr_copy(&info.addr, addr);
+  } else {
+    memset(&info.addr, 0, sizeof(info.addr));
+  }
+  if(notify != NULL) {
+    process_post_synch(notify, channel_switch_event, &info);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The decision comes this long before the activation */
+static clock_time_t
+decision_guard(void)
+{
+  return CHANNEL_SWITCH_DECISION_GUARD +
+    (clock_time_t)own.neighbors * CHANNEL_SWITCH_NBR_SPACING;
+}
+/*---------------------------------------------------------------------------*/
+static void
+activate(void *ptr)
+{
+  own.pending = 0;
+  PRINTF("channel-switch: moving to channel %u\n", own.channel);
+  post(CHANNEL_SWITCH_COMMITTED, own.channel, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+decide(void *ptr)
+{
+  clock_time_t left;
+
+  if((uint16_t)own.acks * 100 <
+     (uint16_t)own.neighbors * CHANNEL_SWITCH_QUORUM) {
+    own.pending = 0;
+    PRINTF("channel-switch: %u/%u acks, staying\n", own.acks, own.neighbors);
+    post(CHANNEL_SWITCH_ROLLED_BACK, own.channel, NULL);
+    return;
+  }
+  left = channel_switch_remaining();
+  if(left == 0) {
+    activate(NULL);
+  } else {
+    ctimer_set(&own.timer, left, activate, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_switch_start(uint8_t channel, clock_time_t delay, uint8_t neighbors)
+{
+  uint8_t *a;
+
+  if(own.pending) {
+    return 0;
+  }
+  if(acked_registered) {
+    for(a = nbr_table_head(acked); a != NULL; a = nbr_table_next(acked, a)) {
+      nbr_table_remove(acked, a);
+    }
+  }
+  own.pending = 1;
+  own.channel = channel;
+  own.neighbors = neighbors;
+  own.acks = 0;
+  own.activation = clock_time() + delay;
+  if(delay > decision_guard()) {
+    ctimer_set(&own.timer, delay - decision_guard(), decide, NULL);
+  } else {
+    /* No time to roll back, the acks cannot arrive before we decide */
+    ctimer_set(&own.timer, delay, activate, NULL);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_switch_ack(const uip_ipaddr_t *addr, uint8_t channel)
+{
+  uip_ipaddr_t ipaddr;
+  uip_ds6_nbr_t *nbr;
+  rimeaddr_t *lladdr;
+
+  if(!own.pending || channel != own.channel || own.acks >= own.neighbors) {
+    return;
+  }
+  if(!acked_registered) {
+    own.acks++;
+    return;
+  }
+  /* A retransmitted ack must not count twice */
+  uip_ipaddr_copy(&ipaddr, addr);
+  nbr = uip_ds6_nbr_lookup(&ipaddr);
+  if(nbr == NULL) {
+    return;
+  }
+  lladdr = (rimeaddr_t *)uip_ds6_nbr_get_ll(nbr);
+  if(nbr_table_get_from_lladdr(acked, lladdr) != NULL ||
+     nbr_table_add_lladdr(acked, lladdr) == NULL) {
+    return;
+  }
+  own.acks++;
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_switch_nack(uint8_t channel)
+{
+  if(!own.pending || channel != own.channel ||
+     channel_switch_remaining() <= decision_guard()) {
+    return;
+  }
+  ctimer_stop(&own.timer);
+  own.pending = 0;
+  PRINTF("channel-switch: a neighbor cannot follow, staying\n");
+  post(CHANNEL_SWITCH_ROLLED_BACK, own.channel, NULL);
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_switch_pending(void)
+{
+  return own.pending;
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+channel_switch_remaining(void)
+{
+  clock_time_t now;
+
+  now = clock_time();
+  if(!own.pending || (long)(own.activation - now) <= 0) {
+    return 0;
+  }
+  return own.activation - now;
+}
+/*---------------------------------------------------------------------------*/
+static void
+nbr_activate(void *ptr)
+{
+  struct nbr_switch *s = ptr;
+  uip_ipaddr_t addr;
+  uint8_t channel;
+
+  uip_ipaddr_copy(&addr, &s->addr);
+  channel = s->channel;
+  list_remove(nbr_switch_list, s);
+  memb_free(&nbr_switch_memb, s);
+
+  uip_ds6_nbr_set_channel(uip_ds6_nbr_lookup(&addr), channel);
+  post(CHANNEL_SWITCH_NBR_SWITCHED, channel, &addr);
+}
+/*---------------------------------------------------------------------------*/
+static struct nbr_switch *
+nbr_lookup(const uip_ipaddr_t *addr)
+{
+  struct nbr_switch *s;
+
+  for(s = list_head(nbr_switch_list); s != NULL; s = s->next) {
+    if(uip_ipaddr_cmp(&s->addr, addr)) {
+      return s;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_switch_nbr(const uip_ipaddr_t *addr, uint8_t channel,
+                   clock_time_t delay)
+{
+  struct nbr_switch *s;
+
+  s = nbr_lookup(addr);
+  if(s == NULL) {
+    s = memb_alloc(&nbr_switch_memb);
+    if(s == NULL) {
+      return 0;
+    }
+    uip_ipaddr_copy(&s->addr, addr);
+    list_add(nbr_switch_list, s);
+  }
+  s->channel = channel;
+  ctimer_set(&s->timer, delay, nbr_activate, s);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_switch_nbr_cancel(const uip_ipaddr_t *addr)
+{
+  struct nbr_switch *s;
+
+  s = nbr_lookup(addr);
+  if(s != NULL) {
+    ctimer_stop(&s->timer);
+    list_remove(nbr_switch_list, s);
+    memb_free(&nbr_switch_memb, s);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_switch_init(struct process *p)
+{
+  list_init(nbr_switch_list);
+  memb_init(&nbr_switch_memb);
+  if(!acked_registered) {
+    acked_registered = nbr_table_register(acked, NULL);
+  }
+  memset(&own, 0, sizeof(own));
+  notify = p;
+  channel_switch_event = process_alloc_event();
+}
+/*---------------------------------------------------------------------------*/
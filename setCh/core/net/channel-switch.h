@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Scheduled channel switches. The LPBR gives a node a new channel
+ *         and an activation time; the node tells its neighbors, which
+ *         update their entry for it at that instant while the node moves
+ *         itself. If fewer than a quorum of the neighbors acknowledge
+ *         before the decision deadline, the switch is rolled back.
+ */
+
+#ifndef CHANNEL_SWITCH_H
+#define CHANNEL_SWITCH_H
+
+#include "contiki.h"
+#include "net/uip.h"
+
+/* Percentage of the neighbors that must acknowledge a switch */
+#ifdef CHANNEL_SWITCH_CONF_QUORUM
+#define CHANNEL_SWITCH_QUORUM CHANNEL_SWITCH_CONF_QUORUM
+#else
+#define CHANNEL_SWITCH_QUORUM 75
+#endif
+
+/* Time between two messages a node sends its neighbors one by one, so
+   that the neighbor queues keep up */
+#ifdef CHANNEL_SWITCH_CONF_NBR_SPACING
+#define CHANNEL_SWITCH_NBR_SPACING CHANNEL_SWITCH_CONF_NBR_SPACING
+#else
+#define CHANNEL_SWITCH_NBR_SPACING (CLOCK_SECOND / 8)
+#endif
+
+/* Margin before the activation for the last abort to arrive. A node
+   decides this long plus one CHANNEL_SWITCH_NBR_SPACING per neighbor
+   ahead of the activation, so that every neighbor gets its abort in
+   time. */
+#ifdef CHANNEL_SWITCH_CONF_DECISION_GUARD
+#define CHANNEL_SWITCH_DECISION_GUARD CHANNEL_SWITCH_CONF_DECISION_GUARD
+#else
+#define CHANNEL_SWITCH_DECISION_GUARD (2 * CLOCK_SECOND)
+#endif
+
+/* Neighbor switches that can be pending at once */
+#ifdef CHANNEL_SWITCH_CONF_MAX_PENDING
+#define CHANNEL_SWITCH_MAX_PENDING CHANNEL_SWITCH_CONF_MAX_PENDING
+#else
+#define CHANNEL_SWITCH_MAX_PENDING 4
+#endif
+
+/* Activation times go on air in milliseconds */
+#define CHANNEL_SWITCH_TICKS(ms) ((clock_time_t)(((unsigned long)(ms) * CLOCK_SECOND) / 1000))
+#define CHANNEL_SWITCH_MS(ticks) ((uint16_t)(((unsigned long)(ticks) * 1000) / CLOCK_SECOND))
+
+enum {
+  CHANNEL_SWITCH_COMMITTED,   /* we moved to the new channel */
+  CHANNEL_SWITCH_ROLLED_BACK, /* too few acks, we stay */
+  CHANNEL_SWITCH_NBR_SWITCHED /* a neighbor entry moved */
+};
+
+struct channel_switch_info {
+  uint8_t result;
+  uint8_t channel;
+  /* The neighbor, for CHANNEL_SWITCH_NBR_SWITCHED */
+  uip_ipaddr_t addr;
+};
+
+/* Posted synchronously to the process given to channel_switch_init(),
+   with a struct channel_switch_info as data */
+extern process_event_t channel_switch_event;
+
+void channel_switch_init(struct process *p);
+
+/* Our own switch: neighbors is the number of acks a full quorum is
+   computed from. Returns 0 if a switch is already pending. */
+int channel_switch_start(uint8_t channel, clock_time_t delay,
+                         uint8_t neighbors);
+/* Counts once per neighbor */
+void channel_switch_ack(const uip_ipaddr_t *addr, uint8_t channel);
+/* A neighbor cannot follow: rolls the switch back if it is not decided
+   yet */
+void channel_switch_nack(uint8_t channel);
+int channel_switch_pending(void);
+/* Time left until the pending switch activates */
+clock_time_t channel_switch_remaining(void);
+
+/* A neighbor moves to channel after delay. Returns 0 if too many
+   neighbor switches are pending, the neighbor must then be told. */
+int channel_switch_nbr(const uip_ipaddr_t *addr, uint8_t channel,
+                       clock_time_t delay);
+void channel_switch_nbr_cancel(const uip_ipaddr_t *addr);
+
+#endif /* CHANNEL_SWITCH_H */
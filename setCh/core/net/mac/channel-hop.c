@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Receiver-based channel hopping schedule
+ */
+
+#include "net/mac/channel-hop.h"
+
+/* The channels to hop over, by default 15, 20, 25 and 26, which are
+   clear of the common WiFi channels 1, 6 and 11 */
+#ifdef CHANNEL_HOP_CONF_SET
+#define CHANNEL_HOP_SET CHANNEL_HOP_CONF_SET
+#else
+#define CHANNEL_HOP_SET (CHANNEL_HOP_BIT(15) | CHANNEL_HOP_BIT(20) | \
+                         CHANNEL_HOP_BIT(25) | CHANNEL_HOP_BIT(26))
+#endif
+
+/* Channels of the set that are never used */
+#ifdef CHANNEL_HOP_CONF_BLACKLIST
+#define CHANNEL_HOP_BLACKLIST CHANNEL_HOP_CONF_BLACKLIST
+#else
+#define CHANNEL_HOP_BLACKLIST 0
+#endif
+
+static uint16_t blacklist;
+/*---------------------------------------------------------------------------*/
+void
+channel_hop_init(void)
+{
+  blacklist = CHANNEL_HOP_BLACKLIST;
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_hop_blacklist(uint8_t channel, int blacklisted)
+{
+  if(channel < CHANNEL_HOP_FIRST_CHANNEL ||
+     channel > CHANNEL_HOP_LAST_CHANNEL) {
+    return;
+  }
+  if(blacklisted) {
+    blacklist |= CHANNEL_HOP_BIT(channel);
+  } else {
+    blacklist &= ~CHANNEL_HOP_BIT(channel);
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+channel_hop_channels(void)
+{
+  return CHANNEL_HOP_SET & ~blacklist;
+}
+/*---------------------------------------------------------------------------*/
+/* Mixes the address and the wake-up counter. Only 16-bit arithmetic so
+   that all platforms compute the same schedule. */
+static uint16_t
+hash(const rimeaddr_t *node, uint16_t wakeup)
+{
+  uint16_t h;
+  int i;
+
+  h = 0x5a17;
+  for(i = 0; i < sizeof(rimeaddr_t); i++) {
+    h = (uint16_t)(h * 31 + node->u8[i]);
+  }
+  h ^= wakeup;
+  h ^= h >> 7;
+  h = (uint16_t)((uint32_t)h * 0x2b45u);
+  h ^= h >> 9;
+  h = (uint16_t)((uint32_t)h * 0x9e35u);
+  h ^= h >> 8;
+  return h;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+channel_hop_channel(const rimeaddr_t *node, uint16_t wakeup)
+{
+  uint16_t channels;
+  uint8_t count, n, channel;
+
+  channels = channel_hop_channels();
+  count = 0;
+  for(channel = CHANNEL_HOP_FIRST_CHANNEL;
+      channel <= CHANNEL_HOP_LAST_CHANNEL; channel++) {
+    if(channels & CHANNEL_HOP_BIT(channel)) {
+      count++;
+    }
+  }
+  if(count == 0) {
+    return 0;
+  }
+
+  n = hash(node, wakeup) % count;
+  for(channel = CHANNEL_HOP_FIRST_CHANNEL;
+      channel <= CHANNEL_HOP_LAST_CHANNEL; channel++) {
+    if((channels & CHANNEL_HOP_BIT(channel)) && n-- == 0) {
+      break;
+    }
+  }
+  return channel;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Receiver-based channel hopping schedule. Each node listens on
+ *         a pseudo-random channel from the hopping set at every wake-up,
+ *         derived from its link-layer address and its wake-up counter,
+ *         so any neighbor that knows both can compute it.
+ */
+
+#ifndef CHANNEL_HOP_H
+#define CHANNEL_HOP_H
+
+#include "net/rime/rimeaddr.h"
+
+#define CHANNEL_HOP_FIRST_CHANNEL 11
+#define CHANNEL_HOP_LAST_CHANNEL  26
+
+/* Channel bitmasks have bit 0 for channel 11 and bit 15 for channel 26 */
+#define CHANNEL_HOP_BIT(channel) (1U << ((channel) - CHANNEL_HOP_FIRST_CHANNEL))
+
+void channel_hop_init(void);
+
+/* The channel node listens on at its wake-up number wakeup, or 0 if
+   the whole hopping set is blacklisted */
+uint8_t channel_hop_channel(const rimeaddr_t *node, uint16_t wakeup);
+
+/* The blacklist changes the schedule of every node, so all nodes of a
+   network must blacklist the same channels */
+void channel_hop_blacklist(uint8_t channel, int blacklisted);
+uint16_t channel_hop_channels(void);
+
+#endif /* CHANNEL_HOP_H */
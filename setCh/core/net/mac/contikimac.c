@@ -45,6 +45,8 @@
 #include "dev/watchdog.h"
 #include "lib/random.h"
 #include "net/mac/contikimac.h"
+#include "net/mac/nbr-channel.h"
+#include "net/mac/radio-channel.h"
 #include "net/netstack.h"
 #include "net/rime.h"
 #include "sys/compower.h"
@@ -54,10 +56,6 @@
 
 #include <string.h>
 
-//ADILA EDIT 10/11/14
-#include "net/uip-ds6.h"
-//-------------------
-
 /* TX/RX cycles are synchronized with neighbor wake periods */
 #ifdef CONTIKIMAC_CONF_WITH_PHASE_OPTIMIZATION
 #define WITH_PHASE_OPTIMIZATION      CONTIKIMAC_CONF_WITH_PHASE_OPTIMIZATION
@@ -87,18 +85,99 @@
 #ifndef RDC_CONF_MCU_SLEEP
 #define RDC_CONF_MCU_SLEEP           0
 #endif
+/* Sample the energy on one other channel in the sleep gap of every
+   SPECTRUM_SURVEY_INTERVAL cycles */
+#ifdef CONTIKIMAC_CONF_SPECTRUM_SURVEY
+#define WITH_SPECTRUM_SURVEY         CONTIKIMAC_CONF_SPECTRUM_SURVEY
+#else
+#define WITH_SPECTRUM_SURVEY         0
+#endif
+#ifdef CONTIKIMAC_CONF_SPECTRUM_SURVEY_INTERVAL
+#define SPECTRUM_SURVEY_INTERVAL     CONTIKIMAC_CONF_SPECTRUM_SURVEY_INTERVAL
+#else
+#define SPECTRUM_SURVEY_INTERVAL     8
+#endif
+/* Look for a neighbor on other channels when it does not ack on the
+   channel we know for it, or when we know none */
+#ifdef CONTIKIMAC_CONF_CHANNEL_DISCOVERY
+#define WITH_CHANNEL_DISCOVERY       CONTIKIMAC_CONF_CHANNEL_DISCOVERY
+#else
+#define WITH_CHANNEL_DISCOVERY       1
+#endif
+/* Channels tried in one discovery, each costs one strobe train */
+#ifdef CONTIKIMAC_CONF_DISCOVERY_CHANNELS
+#define DISCOVERY_CHANNELS           CONTIKIMAC_CONF_DISCOVERY_CHANNELS
+#else
+#define DISCOVERY_CHANNELS           3
+#endif
+/* Unacked transmissions on a known channel before a discovery. Later
+   discoveries back off exponentially. */
+#ifdef CONTIKIMAC_CONF_DISCOVERY_FAILURES
+#define DISCOVERY_FAILURES           CONTIKIMAC_CONF_DISCOVERY_FAILURES
+#else
+#define DISCOVERY_FAILURES           2
+#endif
+/* The channel all nodes start on */
+#ifdef CONTIKIMAC_CONF_DEFAULT_CHANNEL
+#define DEFAULT_CHANNEL              CONTIKIMAC_CONF_DEFAULT_CHANNEL
+#else
+#define DEFAULT_CHANNEL              26
+#endif
+/* Receiver-based channel hopping: at every wake-up we check our own
+   channel and then the channel the hopping schedule gives for that
+   wake-up. Neighbors that know our phase and wake-up counter transmit
+   on the hopping channel, others on our own channel. All nodes of a
+   network must agree on this setting, it changes the header. */
+#ifdef CONTIKIMAC_CONF_CHANNEL_HOPPING
+#define WITH_CHANNEL_HOPPING         CONTIKIMAC_CONF_CHANNEL_HOPPING
+#else
+#define WITH_CHANNEL_HOPPING         0
+#endif
+/* Broadcasts also reach neighbors that listen on other channels than
+   DEFAULT_CHANNEL: as unicast copies on their channels, or strobed
+   over a whole rendezvous interval, during which every node checks
+   DEFAULT_CHANNEL once. */
+#ifdef CONTIKIMAC_CONF_MULTICHANNEL_BROADCAST
+#define WITH_MULTICHANNEL_BROADCAST  CONTIKIMAC_CONF_MULTICHANNEL_BROADCAST
+#else
+#define WITH_MULTICHANNEL_BROADCAST  0
+#endif
+/* Wake-ups between two rendezvous checks. The rendezvous strobe train
+   lasts this many cycles, which must stay below half the rtimer
+   range. */
+#ifdef CONTIKIMAC_CONF_RENDEZVOUS_INTERVAL
+#define RENDEZVOUS_INTERVAL          CONTIKIMAC_CONF_RENDEZVOUS_INTERVAL
+#else
+#define RENDEZVOUS_INTERVAL          4
+#endif
 
 #if NETSTACK_RDC_CHANNEL_CHECK_RATE >= 64
 #undef WITH_PHASE_OPTIMIZATION
 #define WITH_PHASE_OPTIMIZATION 0
 #endif
 
+/* Hopping needs the phase of the receiver, and the header to tell
+   neighbors our wake-up counter */
+#if !WITH_PHASE_OPTIMIZATION || !WITH_CONTIKIMAC_HEADER
+#undef WITH_CHANNEL_HOPPING
+#define WITH_CHANNEL_HOPPING 0
+#endif
+
 #if WITH_CONTIKIMAC_HEADER
 #define CONTIKIMAC_ID 0x00
 
 struct hdr {
   uint8_t id;
   uint8_t len;
+  /* The channel we listen on, so that neighbors learn it from any
+     frame we send */
+  uint8_t channel;
+#if WITH_CHANNEL_HOPPING
+  /* Our wake-up counter, and the clock ticks since that wake-up when
+     the packet was created */
+  uint8_t wakeup[2];
+  uint8_t age;
+#endif /* WITH_CHANNEL_HOPPING */
 };
 #endif /* WITH_CONTIKIMAC_HEADER */
 
@@ -192,7 +271,7 @@ static int we_are_receiving_burst = 0;
 
 /* GUARD_TIME is the time before the expected phase of a neighbor that
    a transmitted should begin transmitting packets. */
-#define GUARD_TIME                         10 * CHECK_TIME + CHECK_TIME_TX
+#define GUARD_TIME                         (10 * CHECK_TIME + CHECK_TIME_TX)
 
 /* INTER_PACKET_INTERVAL is the interval between two successive packet transmissions */
 #ifdef CONTIKIMAC_CONF_INTER_PACKET_INTERVAL
@@ -260,6 +339,64 @@ static struct compower_activity current_packet;
 
 #endif /* WITH_PHASE_OPTIMIZATION */
 
+#if WITH_SPECTRUM_SURVEY
+#include "net/mac/spectrum-survey.h"
+#endif /* WITH_SPECTRUM_SURVEY */
+
+#if WITH_CHANNEL_DISCOVERY
+#include "net/channel-estimator.h"
+
+/* Set while send_packet() probes a candidate channel of the receiver.
+   The probe strobes a full cycle instead of waiting for a phase learned
+   on the old channel, and its outcome says nothing about that phase. */
+static uint8_t discovery_probe;
+#endif /* WITH_CHANNEL_DISCOVERY */
+
+/* Channels checked at every wake-up: our own, the hopping channel and
+   the rendezvous channel */
+#define CHANNEL_CHECKS (1 + WITH_CHANNEL_HOPPING + WITH_MULTICHANNEL_BROADCAST)
+
+#include "net/uip-ds6.h"
+
+/* The channel assigned to us, checked at every wake-up */
+#define HOME_CHANNEL (uip_ds6_if.addr_list[1].currentCh)
+
+#if CHANNEL_CHECKS > 1
+/* Our wake-up counter */
+static uint16_t wakeups;
+#endif /* CHANNEL_CHECKS > 1 */
+
+/* Stays zero without WITH_MULTICHANNEL_BROADCAST */
+struct contikimac_broadcast_stats contikimac_broadcast_stats;
+
+#if WITH_MULTICHANNEL_BROADCAST
+/* A broadcast strobed over the rendezvous interval */
+#define RENDEZVOUS_STROBE_TIME (RENDEZVOUS_INTERVAL * CYCLE_TIME + 2 * CHECK_TIME)
+
+/* Set while send_packet() sends a broadcast over the rendezvous
+   interval, or a unicast copy of a broadcast */
+static uint8_t broadcast_rendezvous;
+static uint8_t broadcast_copy;
+/* The strobe time of the last send_packet() */
+static rtimer_clock_t last_airtime;
+#endif /* WITH_MULTICHANNEL_BROADCAST */
+
+#if WITH_CHANNEL_HOPPING
+#include "net/mac/channel-hop.h"
+
+/* The header age of packets that may be strobed for longer than the
+   error a receiver can take when it counts our wake-ups from it */
+#define WAKEUP_AGE_UNKNOWN 0xff
+
+#define CYCLE_CLOCK (CLOCK_SECOND / NETSTACK_RDC_CHANNEL_CHECK_RATE)
+#define GUARD_CLOCK ((CLOCK_SECOND * (unsigned long)GUARD_TIME) / RTIMER_ARCH_SECOND)
+
+/* The clock time of our last wake-up */
+static clock_time_t wakeup_time;
+/* The channel of the last unicast, where a burst continues */
+static uint8_t burst_channel;
+#endif /* WITH_CHANNEL_HOPPING */
+
 #define DEFAULT_STREAM_TIME (4 * CYCLE_TIME)
 
 #ifndef MIN
@@ -368,6 +505,39 @@ powercycle_turn_radio_on(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if CHANNEL_CHECKS > 1
+/* The channel of the check-th channel check of this wake-up, or 0 to
+   skip the check */
+static uint8_t
+wakeup_channel(uint8_t check)
+{
+  uint8_t hop_channel;
+
+  if(we_are_sending || we_are_receiving_burst) {
+    return 0;
+  }
+  if(check == 0) {
+    return HOME_CHANNEL;
+  }
+
+  hop_channel = HOME_CHANNEL;
+#if WITH_CHANNEL_HOPPING
+  hop_channel = channel_hop_channel(&rimeaddr_node_addr, wakeups);
+  if(check == 1) {
+    return hop_channel == HOME_CHANNEL ? 0 : hop_channel;
+  }
+#endif /* WITH_CHANNEL_HOPPING */
+
+#if WITH_MULTICHANNEL_BROADCAST
+  if(wakeups % RENDEZVOUS_INTERVAL == 0 &&
+     HOME_CHANNEL != DEFAULT_CHANNEL && hop_channel != DEFAULT_CHANNEL) {
+    return DEFAULT_CHANNEL;
+  }
+#endif /* WITH_MULTICHANNEL_BROADCAST */
+  return 0;
+}
+#endif /* CHANNEL_CHECKS > 1 */
+/*---------------------------------------------------------------------------*/
 static char
 powercycle(struct rtimer *t, void *ptr)
 {
@@ -409,7 +579,26 @@ powercycle(struct rtimer *t, void *ptr)
 
     packet_seen = 0;
 
-    for(count = 0; count < CCA_COUNT_MAX; ++count) {
+#if CHANNEL_CHECKS > 1
+    wakeups++;
+#endif /* CHANNEL_CHECKS > 1 */
+#if WITH_CHANNEL_HOPPING
+    wakeup_time = clock_time();
+#endif /* WITH_CHANNEL_HOPPING */
+
+    for(count = 0; count < CCA_COUNT_MAX * CHANNEL_CHECKS; ++count) {
+#if CHANNEL_CHECKS > 1
+      if(count % CCA_COUNT_MAX == 0) {
+        /* Nothing seen so far, move on to the next channel */
+        static uint8_t check_channel;
+        check_channel = wakeup_channel(count / CCA_COUNT_MAX);
+        if(check_channel == 0) {
+          count += CCA_COUNT_MAX - 1;
+          continue;
+        }
+        radio_channel_set(check_channel);
+      }
+#endif /* CHANNEL_CHECKS > 1 */
       t0 = RTIMER_NOW();
       if(we_are_sending == 0 && we_are_receiving_burst == 0) {
         powercycle_turn_radio_on();
@@ -488,6 +677,22 @@ powercycle(struct rtimer *t, void *ptr)
       }
     }
 
+#if WITH_SPECTRUM_SURVEY
+    {
+      static uint8_t survey_cycles;
+      /* Only when nothing was heard and the radio is idle, with enough
+         of the cycle left for the two channel switches */
+      if(++survey_cycles >= SPECTRUM_SURVEY_INTERVAL && !packet_seen &&
+         we_are_sending == 0 && we_are_receiving_burst == 0 &&
+         !radio_is_on &&
+         RTIMER_CLOCK_LT(RTIMER_NOW() - cycle_start,
+                         CYCLE_TIME - CHECK_TIME * 8)) {
+        survey_cycles = 0;
+        spectrum_survey_sample();
+      }
+    }
+#endif /* WITH_SPECTRUM_SURVEY */
+
     if(RTIMER_CLOCK_LT(RTIMER_NOW() - cycle_start, CYCLE_TIME - CHECK_TIME * 4)) {
       /* Schedule the next powercycle interrupt, or sleep the mcu
 	 until then.  Sleeping will not exit from this interrupt, so
@@ -551,12 +756,16 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   int ret;
   uint8_t contikimac_was_on;
   uint8_t seqno;
+  uint8_t channel;
+  rtimer_clock_t strobe_time;
 #if WITH_CONTIKIMAC_HEADER
   struct hdr *chdr;
 #endif /* WITH_CONTIKIMAC_HEADER */
-
-  //ADILA EDIT 09/02/15
-  static uip_ds6_nbr_t *nbr;
+#if WITH_CHANNEL_HOPPING
+  uint8_t is_hopping = 0;
+  uint16_t hop_wakeup;
+  clock_time_t age;
+#endif /* WITH_CHANNEL_HOPPING */
 
   /* Exit if RDC and radio were explicitly turned off */
    if(!contikimac_is_on && !contikimac_keep_radio_on) {
@@ -580,7 +789,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
     //ADILA EDIT 3 AUG 2015
     /* Broadcast is sent in the default channel for unknown nodes. Known neighbours
        are sent using unicast (RPL control packets) */
-    cc2420_set_channel(26);
+    radio_channel_set(DEFAULT_CHANNEL);
     //printf("B %d\n", cc2420_get_channel());
 
     if(broadcast_rate_drop()) {
@@ -588,23 +797,27 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
     }
   } else {
 #if UIP_CONF_IPV6
-
-  //ADILA EDIT 11/05/15
-  /* NT has information of the channels for all nodes in range (including parent) 
-     This allows the sender to change into the correct transmitting channel */
-  for(nbr = nbr_table_head(ds6_neighbors); nbr != NULL;
-    nbr = nbr_table_next(ds6_neighbors,nbr)) {
-    if((nbr->ipaddr.u8[13]) == (packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[5])) {
-      cc2420_set_channel(nbr->nbrCh);
-    }
-  }
-
-  //printf("U %d\n", cc2420_get_channel());
+    PRINTDEBUG("contikimac: send unicast to %02x%02x:%02x%02x:%02x%02x:%02x%02x\n",
+               packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0],
+               packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[1],
+               packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[2],
+               packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[3],
+               packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[4],
+               packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[5],
+               packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[6],
+               packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[7]);
 #else /* UIP_CONF_IPV6 */
     PRINTDEBUG("contikimac: send unicast to %u.%u\n",
                packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0],
                packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[1]);
 #endif /* UIP_CONF_IPV6 */
+
+    /* Transmit on the channel the receiver listens on, if we know it.
+       The cache is keyed on the full link-layer address. */
+    channel = nbr_channel_get(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    if(channel != NBR_CHANNEL_UNKNOWN) {
+      radio_channel_set(channel);
+    }
   }
   is_reliable = packetbuf_attr(PACKETBUF_ATTR_RELIABLE) ||
     packetbuf_attr(PACKETBUF_ATTR_ERELIABLE);
@@ -621,6 +834,25 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   chdr = packetbuf_hdrptr();
   chdr->id = CONTIKIMAC_ID;
   chdr->len = hdrlen;
+  chdr->channel = HOME_CHANNEL;
+#if WITH_CHANNEL_HOPPING
+  chdr->wakeup[0] = wakeups & 0xff;
+  chdr->wakeup[1] = wakeups >> 8;
+  age = clock_time() - wakeup_time;
+  /* Only short strobe trains arrive close enough to now: bursts and
+     packets to a receiver we have a phase lock for */
+  if(age >= WAKEUP_AGE_UNKNOWN || is_broadcast ||
+#if WITH_MULTICHANNEL_BROADCAST
+     broadcast_copy ||
+#endif /* WITH_MULTICHANNEL_BROADCAST */
+#if WITH_CHANNEL_DISCOVERY
+     discovery_probe ||
+#endif /* WITH_CHANNEL_DISCOVERY */
+     !(is_receiver_awake || phase_known(packetbuf_addr(PACKETBUF_ADDR_RECEIVER)))) {
+    age = WAKEUP_AGE_UNKNOWN;
+  }
+  chdr->age = age;
+#endif /* WITH_CHANNEL_HOPPING */
   
   /* Create the MAC header for the data packet. */
   hdrlen = NETSTACK_FRAMER.create();
@@ -667,7 +899,16 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   /* Remove the MAC-layer header since it will be recreated next time around. */
   packetbuf_hdr_remove(hdrlen);
 
-  if(!is_broadcast && !is_receiver_awake) {
+  if(!is_broadcast && !is_receiver_awake
+#if WITH_MULTICHANNEL_BROADCAST
+     /* A deferred copy would come back as a packet of its own */
+     && !broadcast_copy
+#endif /* WITH_MULTICHANNEL_BROADCAST */
+#if WITH_CHANNEL_DISCOVERY
+     /* A deferred probe would go out after the channel is restored */
+     && !discovery_probe
+#endif /* WITH_CHANNEL_DISCOVERY */
+     ) {
 #if WITH_PHASE_OPTIMIZATION
     ret = phase_wait(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
                      CYCLE_TIME, GUARD_TIME,
@@ -680,6 +921,28 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
     }
 #endif /* WITH_PHASE_OPTIMIZATION */ 
   }
+
+#if WITH_CHANNEL_HOPPING
+  if(!is_broadcast) {
+    if(is_receiver_awake) {
+      /* A burst continues on the channel the receiver woke up on */
+      radio_channel_set(burst_channel);
+    } else if(is_known_receiver &&
+              phase_get_wakeup(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                               clock_time() + GUARD_CLOCK, CYCLE_CLOCK,
+                               &hop_wakeup)) {
+      /* The receiver checks its hopping channel at the wake-up we are
+         about to hit */
+      channel = channel_hop_channel(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                                    hop_wakeup);
+      if(channel != 0) {
+        radio_channel_set(channel);
+        is_hopping = 1;
+      }
+    }
+    burst_channel = radio_channel_get();
+  }
+#endif /* WITH_CHANNEL_HOPPING */
   
   /* By setting we_are_sending to one, we ensure that the rtimer
      powercycle interrupt do not interfere with us sending the packet. */
@@ -754,12 +1017,19 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   }
 #endif
 
+  strobe_time = STROBE_TIME;
+#if WITH_MULTICHANNEL_BROADCAST
+  if(is_broadcast && broadcast_rendezvous) {
+    strobe_time = RENDEZVOUS_STROBE_TIME;
+  }
+#endif /* WITH_MULTICHANNEL_BROADCAST */
+
   watchdog_periodic();
   t0 = RTIMER_NOW();
   seqno = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
   for(strobes = 0, collisions = 0;
       got_strobe_ack == 0 && collisions == 0 &&
-      RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + STROBE_TIME); strobes++) {
+      RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + strobe_time); strobes++) {
 
     watchdog_periodic();
 
@@ -825,6 +1095,10 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
 
   off();
 
+#if WITH_MULTICHANNEL_BROADCAST
+  last_airtime = RTIMER_NOW() - t0;
+#endif /* WITH_MULTICHANNEL_BROADCAST */
+
   PRINTF("contikimac: send (strobes=%u, len=%u, %s, %s), done\n", strobes,
          packetbuf_totlen(),
          got_strobe_ack ? "ack" : "no ack",
@@ -866,7 +1140,11 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
            strobes);
   }
 
-  if(!is_broadcast) {
+  if(!is_broadcast
+#if WITH_CHANNEL_DISCOVERY
+     && !discovery_probe
+#endif /* WITH_CHANNEL_DISCOVERY */
+     ) {
     if(collisions == 0 && is_receiver_awake == 0) {
       phase_update(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
 		   encounter_time, ret);
@@ -874,13 +1152,230 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   }
 #endif /* WITH_PHASE_OPTIMIZATION */
 
+#if WITH_CHANNEL_HOPPING
+  if(is_hopping && collisions == 0) {
+    if(got_strobe_ack) {
+      /* The ack confirms the wake-up counter, count from here on */
+      phase_set_wakeup(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                       clock_time(), hop_wakeup);
+    } else {
+      /* Reach it on its own channel until it tells us its counter
+         again */
+      phase_forget_wakeup(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    }
+  }
+#endif /* WITH_CHANNEL_HOPPING */
+
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+#if WITH_CHANNEL_DISCOVERY
+static int
+add_candidate(uint8_t *channels, int n, uint8_t channel, uint8_t tried)
+{
+  int i;
+
+  if(channel == NBR_CHANNEL_UNKNOWN || channel == tried ||
+     n >= DISCOVERY_CHANNELS) {
+    return n;
+  }
+  for(i = 0; i < n; i++) {
+    if(channels[i] == channel) {
+      return n;
+    }
+  }
+  channels[n] = channel;
+  return n + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* The channels to look for a neighbor on, most likely first: those we
+   have reached or heard it on, the channel all nodes start on, then the
+   channels that are best around us, which is where the LPBR moves
+   nodes to. */
+static int
+discovery_candidates(const rimeaddr_t *neighbor, uint8_t tried,
+                     uint8_t *channels)
+{
+  int n;
+#if CHANNEL_ESTIMATOR_ENABLED
+  struct channel_estimate estimates[CHANNEL_ESTIMATOR_NUM_CHANNELS];
+  uint8_t ranked[CHANNEL_ESTIMATOR_NUM_CHANNELS];
+  const struct channel_estimate *e;
+  int i, count;
+#endif /* CHANNEL_ESTIMATOR_ENABLED */
+
+  n = 0;
+#if CHANNEL_ESTIMATOR_ENABLED
+  for(i = 0; i < CHANNEL_ESTIMATOR_NUM_CHANNELS; i++) {
+    e = channel_estimator_get(neighbor, CHANNEL_ESTIMATOR_FIRST_CHANNEL + i);
+    if(e != NULL) {
+      estimates[i] = *e;
+    } else {
+      channel_estimate_init(&estimates[i]);
+    }
+  }
+  count = channel_estimate_rank(estimates, ranked,
+                                CHANNEL_ESTIMATOR_NUM_CHANNELS);
+  for(i = 0; i < count; i++) {
+    if(estimates[ranked[i] - CHANNEL_ESTIMATOR_FIRST_CHANNEL].samples > 0) {
+      n = add_candidate(channels, n, ranked[i], tried);
+    }
+  }
+#endif /* CHANNEL_ESTIMATOR_ENABLED */
+
+  n = add_candidate(channels, n, DEFAULT_CHANNEL, tried);
+
+#if CHANNEL_ESTIMATOR_ENABLED
+  count = channel_estimator_rank(ranked, CHANNEL_ESTIMATOR_NUM_CHANNELS);
+  for(i = 0; i < count; i++) {
+    n = add_candidate(channels, n, ranked[i], tried);
+  }
+#endif /* CHANNEL_ESTIMATOR_ENABLED */
+
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Discover after threshold, 2 * threshold, 4 * threshold, ... failures */
+static int
+discovery_due(uint8_t failures, uint8_t threshold)
+{
+  uint8_t rounds;
+
+  if(failures < threshold || failures % threshold != 0) {
+    return 0;
+  }
+  rounds = failures / threshold;
+  return (rounds & (rounds - 1)) == 0;
+}
+#endif /* WITH_CHANNEL_DISCOVERY */
+/*---------------------------------------------------------------------------*/
+#if WITH_MULTICHANNEL_BROADCAST
+/* Sends a broadcast on DEFAULT_CHANNEL, and reaches the neighbors on
+   other channels either with one unicast copy each, grouped by
+   channel, or by strobing the broadcast over a rendezvous interval.
+   Copies are not phase locked, so each costs about as much as the
+   broadcast itself, and we pick whatever takes less airtime. */
+static int
+send_broadcast(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
+{
+  const rimeaddr_t *neighbor;
+  uint8_t channel, c;
+  unsigned copies;
+  int ret;
+
+  copies = 0;
+  for(neighbor = nbr_channel_next(NULL, &channel); neighbor != NULL;
+      neighbor = nbr_channel_next(neighbor, &channel)) {
+    if(channel != NBR_CHANNEL_UNKNOWN && channel != DEFAULT_CHANNEL) {
+      copies++;
+    }
+  }
+
+  broadcast_rendezvous = (unsigned long)(copies + 1) * STROBE_TIME >
+    (unsigned long)RENDEZVOUS_STROBE_TIME;
+  ret = send_packet(sent, ptr, buf_list, 0);
+  contikimac_broadcast_stats.airtime += last_airtime;
+  if(broadcast_rendezvous) {
+    broadcast_rendezvous = 0;
+    contikimac_broadcast_stats.rendezvous++;
+    return ret;
+  }
+  if(ret != MAC_TX_OK || copies == 0) {
+    return ret;
+  }
+
+  contikimac_broadcast_stats.replicated++;
+  broadcast_copy = 1;
+  /* IEEE 802.15.4 channels 11-26 */
+  for(c = 11; c <= 26; c++) {
+    if(c == DEFAULT_CHANNEL) {
+      continue;
+    }
+    for(neighbor = nbr_channel_next(NULL, &channel); neighbor != NULL;
+        neighbor = nbr_channel_next(neighbor, &channel)) {
+      if(channel == c) {
+        PRINTF("contikimac: broadcast copy to %d.%d on channel %d\n",
+               neighbor->u8[0], neighbor->u8[1], c);
+        packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, neighbor);
+        send_packet(sent, ptr, buf_list, 0);
+        contikimac_broadcast_stats.copies++;
+        contikimac_broadcast_stats.airtime += last_airtime;
+      }
+    }
+  }
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &rimeaddr_null);
+  broadcast_copy = 0;
+
+  return ret;
+}
+#endif /* WITH_MULTICHANNEL_BROADCAST */
+/*---------------------------------------------------------------------------*/
+/* Sends the packet and, if a unicast was not acked, looks for the
+   receiver on the candidate channels. The channel that gets an ack is
+   kept for the receiver. */
+static int
+send_discover(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list,
+              int is_receiver_awake)
+{
+  int ret;
+#if WITH_CHANNEL_DISCOVERY
+  rimeaddr_t receiver;
+  uint8_t channels[DISCOVERY_CHANNELS];
+  uint8_t tried;
+  uint8_t failures;
+  int i, n;
+#endif /* WITH_CHANNEL_DISCOVERY */
+
+#if WITH_MULTICHANNEL_BROADCAST
+  if(rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &rimeaddr_null)) {
+    return send_broadcast(sent, ptr, buf_list);
+  }
+#endif /* WITH_MULTICHANNEL_BROADCAST */
+
+  ret = send_packet(sent, ptr, buf_list, is_receiver_awake);
+
+#if WITH_CHANNEL_DISCOVERY
+  if(is_receiver_awake ||
+     rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &rimeaddr_null) ||
+     (ret != MAC_TX_OK && ret != MAC_TX_NOACK)) {
+    return ret;
+  }
+
+  rimeaddr_copy(&receiver, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  tried = nbr_channel_get(&receiver);
+  failures = nbr_channel_tx(&receiver, ret == MAC_TX_OK);
+  if(ret == MAC_TX_OK ||
+     !discovery_due(failures, tried == NBR_CHANNEL_UNKNOWN ? 1 : DISCOVERY_FAILURES)) {
+    return ret;
+  }
+
+  n = discovery_candidates(&receiver, tried, channels);
+  discovery_probe = 1;
+  for(i = 0; i < n && ret == MAC_TX_NOACK; i++) {
+    PRINTF("contikimac: looking for %d.%d on channel %d\n",
+           receiver.u8[0], receiver.u8[1], channels[i]);
+    /* send_packet() transmits on the cached channel of the receiver */
+    nbr_channel_set(&receiver, channels[i]);
+    ret = send_packet(sent, ptr, buf_list, 0);
+  }
+  discovery_probe = 0;
+
+  if(ret == MAC_TX_OK) {
+    PRINTF("contikimac: found %d.%d on channel %d\n",
+           receiver.u8[0], receiver.u8[1], channels[i - 1]);
+    nbr_channel_tx(&receiver, 1);
+  } else {
+    nbr_channel_set(&receiver, tried);
+  }
+#endif /* WITH_CHANNEL_DISCOVERY */
+
   return ret;
 }
 /*---------------------------------------------------------------------------*/
 static void
 qsend_packet(mac_callback_t sent, void *ptr)
 {
-  int ret = send_packet(sent, ptr, NULL, 0);
+  int ret = send_discover(sent, ptr, NULL, 0);
   if(ret != MAC_TX_DEFERRED) {
     mac_call_sent_callback(sent, ptr, ret, 1);
   }
@@ -917,7 +1412,7 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
     }
 
     /* Send the current packet */
-    ret = send_packet(sent, ptr, curr, is_receiver_awake);
+    ret = send_discover(sent, ptr, curr, is_receiver_awake);
     if(ret != MAC_TX_DEFERRED) {
       mac_call_sent_callback(sent, ptr, ret, 1);
     }
@@ -968,6 +1463,14 @@ input_packet(void)
       PRINTF("contikimac: failed to parse hdr (%u)\n", packetbuf_totlen());
       return;
     }
+    packetbuf_set_attr(PACKETBUF_ATTR_SENDER_CHANNEL, chdr->channel);
+#if WITH_CHANNEL_HOPPING
+    if(chdr->age != WAKEUP_AGE_UNKNOWN) {
+      phase_set_wakeup(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                       clock_time() - chdr->age,
+                       chdr->wakeup[0] | (chdr->wakeup[1] << 8));
+    }
+#endif /* WITH_CHANNEL_HOPPING */
     packetbuf_hdrreduce(sizeof(struct hdr));
     packetbuf_set_datalen(chdr->len);
 #endif /* WITH_CONTIKIMAC_HEADER */
@@ -1055,6 +1558,15 @@ init(void)
   phase_init();
 #endif /* WITH_PHASE_OPTIMIZATION */
 
+  nbr_channel_init();
+
+#if WITH_SPECTRUM_SURVEY
+  spectrum_survey_init();
+#endif /* WITH_SPECTRUM_SURVEY */
+
+#if WITH_CHANNEL_HOPPING
+  channel_hop_init();
+#endif /* WITH_CHANNEL_HOPPING */
 }
 /*---------------------------------------------------------------------------*/
 static int
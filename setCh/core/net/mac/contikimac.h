@@ -46,4 +46,16 @@
 
 extern const struct rdc_driver contikimac_driver;
 
+struct contikimac_broadcast_stats {
+  /* Broadcasts that reached other channels through unicast copies, and
+     through a rendezvous */
+  unsigned long replicated, rendezvous;
+  /* Unicast copies sent */
+  unsigned long copies;
+  /* Time spent strobing broadcasts and their copies, in rtimer ticks */
+  unsigned long airtime;
+};
+
+extern struct contikimac_broadcast_stats contikimac_broadcast_stats;
+
 #endif /* CONTIKIMAC_H */
@@ -59,6 +59,9 @@
 #include "net/uip-ds6.h"
 #include "net/retx-table.h"
 //-------------------
+#include "net/mac/nbr-channel.h"
+#include "net/mac/radio-channel.h"
+#include "net/channel-estimator.h"
 
 #define DEBUG 0
 #if DEBUG
@@ -81,6 +84,18 @@
 #error Change CSMA_CONF_MAX_MAC_TRANSMISSIONS in contiki-conf.h or in your Makefile.
 #endif /* CSMA_CONF_MAX_MAC_TRANSMISSIONS < 1 */
 
+/* When channel grouping is enabled, a neighbor queue that is waiting
+   to send its first packet to a destination on the channel we are
+   already tuned to is served before the radio goes back to our
+   listening channel. At most CSMA_CHANNEL_GROUP_MAX queues are served
+   this way in a row, to bound the time spent away from the listening
+   channel. */
+#ifdef CSMA_CONF_CHANNEL_GROUPING
+#define CSMA_CHANNEL_GROUPING CSMA_CONF_CHANNEL_GROUPING
+#else
+#define CSMA_CHANNEL_GROUPING 0
+#endif /* CSMA_CONF_CHANNEL_GROUPING */
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
@@ -95,7 +110,12 @@ struct neighbor_queue {
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions, deferrals;
-  LIST_STRUCT(queued_packet_list);
+#if CSMA_CHANNEL_GROUPING
+  /* Set when the queue was served without leaving the previous
+     destination's channel */
+  uint8_t grouped;
+#endif /* CSMA_CHANNEL_GROUPING */
+  LIST_TAIL_STRUCT(queued_packet_list);
 };
 
 /* The maximum number of co-existing neighbor queues */
@@ -105,14 +125,28 @@ struct neighbor_queue {
 #define CSMA_MAX_NEIGHBOR_QUEUES 2
 #endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
 
+#ifdef CSMA_CONF_CHANNEL_GROUP_MAX
+#define CSMA_CHANNEL_GROUP_MAX CSMA_CONF_CHANNEL_GROUP_MAX
+#else
+#define CSMA_CHANNEL_GROUP_MAX 4
+#endif /* CSMA_CONF_CHANNEL_GROUP_MAX */
+
+#define LISTENING_CHANNEL (uip_ds6_if.addr_list[1].currentCh)
+
 #define MAX_QUEUED_PACKETS QUEUEBUF_NUM
-MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
-MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
-MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
+MEMB_FREELIST(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
+MEMB_FREELIST(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
+MEMB_FREELIST(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
 LIST(neighbor_list);
 
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
+
+#if CSMA_CHANNEL_GROUPING
+/* Number of queues served in a row on the current channel */
+static uint8_t group_length;
+static unsigned long switches_avoided;
+#endif /* CSMA_CHANNEL_GROUPING */
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const rimeaddr_t *addr)
@@ -159,25 +193,67 @@ transmit_packet_list(void *ptr)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if CSMA_CHANNEL_GROUPING
+/* Find a queue, other than skip, whose first packet is waiting for its
+   first transmission to a destination that listens on channel. Queues
+   in backoff are left alone. */
+static struct neighbor_queue *
+queue_waiting_on_channel(uint8_t channel, const struct neighbor_queue *skip)
+{
+  struct neighbor_queue *n = list_head(neighbor_list);
+  while(n != NULL) {
+    if(n != skip && list_head(n->queued_packet_list) != NULL &&
+       n->transmissions == 0 && n->collisions == 0 && n->deferrals == 0 &&
+       nbr_channel_get(&n->addr) == channel) {
+      return n;
+    }
+    n = list_item_next(n);
+  }
+  return NULL;
+}
+#endif /* CSMA_CHANNEL_GROUPING */
+/*---------------------------------------------------------------------------*/
+/* Called when a transmission attempt to a destination on channel is
+   over. Returns the radio to our listening channel, unless channel
+   grouping finds another packet to send on the same channel first. */
+static void
+transmission_done(uint8_t channel, const struct neighbor_queue *done)
+{
+#if CSMA_CHANNEL_GROUPING
+  struct neighbor_queue *next;
+
+  if(done != NULL && channel != NBR_CHANNEL_UNKNOWN &&
+     channel != LISTENING_CHANNEL &&
+     group_length < CSMA_CHANNEL_GROUP_MAX) {
+    next = queue_waiting_on_channel(channel, done);
+    if(next != NULL) {
+      /* Staying on the channel saves the switch back to the listening
+         channel and the switch out again for the next packet. They are
+         counted once the packet has been sent. */
+      group_length++;
+      next->grouped = 1;
+      PRINTF("csma: staying on channel %u\n", channel);
+      ctimer_set(&next->transmit_timer, 0, transmit_packet_list, next);
+      return;
+    }
+  }
+  group_length = 0;
+#endif /* CSMA_CHANNEL_GROUPING */
+  radio_channel_set(LISTENING_CHANNEL);
+}
+/*---------------------------------------------------------------------------*/
 static void
 free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
 {
   if(p != NULL) {
+    uint8_t channel = nbr_channel_get(&n->addr);
+
     /* Remove packet from list and deallocate */
-    list_remove(n->queued_packet_list, p);
+    list_tail_remove(n->queued_packet_list, p);
 
     queuebuf_free(p->buf);
     memb_free(&metadata_memb, p->ptr);
     memb_free(&packet_memb, p);
-
-    //ADILA EDIT 09/02/14
-    /* Reset to listening channel when queue is empty
-       Not really require as the radio will be switched off when
-       the queue is empty */
-    if((list_length(n->queued_packet_list)) == 0) {
-      cc2420_set_channel(uip_ds6_if.addr_list[1].currentCh);
-    }
-
     PRINTF("csma: free_queued_packet, queue length %d\n",
         list_length(n->queued_packet_list));
     if(list_head(n->queued_packet_list) != NULL) {
@@ -188,24 +264,35 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
       /* Set a timer for next transmissions */
       ctimer_set(&n->transmit_timer, default_timebase(),
                  transmit_packet_list, n);
-
-      //ADILA EDIT 09/02/14
-      /* Reset to listening channel before sending next in queue */
-      cc2420_set_channel(uip_ds6_if.addr_list[1].currentCh);
-
     } else {
       /* This was the last packet in the queue, we free the neighbor */
       ctimer_stop(&n->transmit_timer);
       list_remove(neighbor_list, n);
       memb_free(&neighbor_memb, n);
-
-      //ADILA EDIT 09/02/14
-      /* Reset to listening channel */
-      cc2420_set_channel(uip_ds6_if.addr_list[1].currentCh);
     }
+
+    /* Back to the listening channel while the queue waits for its
+       next transmission */
+    transmission_done(channel, n);
   }
 }
 /*---------------------------------------------------------------------------*/
+#if CHANNEL_ESTIMATOR_ENABLED
+/* Feed the final outcome of a packet to the per-channel link
+   estimator. Destinations without a known channel were reached on our
+   listening channel. */
+static void
+estimate_link(struct neighbor_queue *n, int status)
+{
+  uint8_t channel = nbr_channel_get(&n->addr);
+
+  if(channel == NBR_CHANNEL_UNKNOWN) {
+    channel = LISTENING_CHANNEL;
+  }
+  channel_estimator_tx(&n->addr, channel, status, n->transmissions);
+}
+#endif /* CHANNEL_ESTIMATOR_ENABLED */
+/*---------------------------------------------------------------------------*/
 static void
 packet_sent(void *ptr, int status, int num_transmissions)
 {
@@ -224,6 +311,13 @@ packet_sent(void *ptr, int status, int num_transmissions)
   if(n == NULL) {
     return;
   }
+#if CSMA_CHANNEL_GROUPING
+  if(n->grouped && status == MAC_TX_OK) {
+    switches_avoided += 2;
+    PRINTF("csma: grouped send, %lu switches avoided\n", switches_avoided);
+  }
+  n->grouped = 0;
+#endif /* CSMA_CHANNEL_GROUPING */
   switch(status) {
   case MAC_TX_OK:
   case MAC_TX_NOACK:
@@ -234,14 +328,13 @@ packet_sent(void *ptr, int status, int num_transmissions)
     break;
   case MAC_TX_DEFERRED:
     n->deferrals++;
+#if CSMA_CHANNEL_GROUPING
+    /* The RDC layer sends the packet later, at the receiver's phase */
+    transmission_done(NBR_CHANNEL_UNKNOWN, NULL);
+#endif /* CSMA_CHANNEL_GROUPING */
     break;
   }
 
-  //ADILA EDIT JULY 2015
-  /* Keeping the last IP address fe80::xxx:xxxx:xxxx:0606 and number of 
-     packet transmissions and collisions to decide on channel changes */
-  retx_set_channel(packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[6], packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[7], ((n->transmissions) + (n->collisions)));
-
   for(q = list_head(n->queued_packet_list);
       q != NULL; q = list_item_next(q)) {
     if(queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO) ==
@@ -294,6 +387,10 @@ packet_sent(void *ptr, int status, int num_transmissions)
 
         if(n->transmissions < metadata->max_transmissions) {
           PRINTF("csma: retransmitting with time %lu %p\n", time, q);
+#if CSMA_CHANNEL_GROUPING
+          /* Do not wait out the backoff on the destination's channel */
+          transmission_done(NBR_CHANNEL_UNKNOWN, NULL);
+#endif /* CSMA_CHANNEL_GROUPING */
           ctimer_set(&n->transmit_timer, time,
                      transmit_packet_list, n);
           /* This is needed to correctly attribute energy that we spent
@@ -302,6 +399,12 @@ packet_sent(void *ptr, int status, int num_transmissions)
         } else {
           PRINTF("csma: drop with status %d after %d transmissions, %d collisions\n",
                  status, n->transmissions, n->collisions);
+#if CHANNEL_ESTIMATOR_ENABLED
+          estimate_link(n, status);
+#endif /* CHANNEL_ESTIMATOR_ENABLED */
+          /* Keep the transmissions and collisions per neighbor to
+             decide on channel changes */
+          retx_table_record(&n->addr, status, n->transmissions, n->collisions);
           free_packet(n, q);
           mac_call_sent_callback(sent, cptr, status, num_tx);
         }
@@ -312,6 +415,10 @@ packet_sent(void *ptr, int status, int num_transmissions)
           PRINTF("csma: rexmit failed %d: %d\n", n->transmissions, status);
         }
 
+#if CHANNEL_ESTIMATOR_ENABLED
+        estimate_link(n, status);
+#endif /* CHANNEL_ESTIMATOR_ENABLED */
+        retx_table_record(&n->addr, status, n->transmissions, n->collisions);
         free_packet(n, q);
         mac_call_sent_callback(sent, cptr, status, num_tx);
       }
@@ -345,8 +452,11 @@ send_packet(mac_callback_t sent, void *ptr)
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
+#if CSMA_CHANNEL_GROUPING
+      n->grouped = 0;
+#endif /* CSMA_CHANNEL_GROUPING */
       /* Init packet list for this neighbor */
-      LIST_STRUCT_INIT(n, queued_packet_list);
+      LIST_TAIL_STRUCT_INIT(n, queued_packet_list);
       /* Add neighbor to the list */
       list_add(neighbor_list, n);
     }
@@ -374,9 +484,9 @@ send_packet(mac_callback_t sent, void *ptr)
 
 	  if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
 	     PACKETBUF_ATTR_PACKET_TYPE_ACK) {
-	    list_push(n->queued_packet_list, q);
+	    list_tail_push(n->queued_packet_list, q);
 	  } else {
-	    list_add(n->queued_packet_list, q);
+	    list_tail_add(n->queued_packet_list, q);
 	  }
 
 	  /* If q is the first packet in the neighbor's queue, send asap */
@@ -405,6 +515,16 @@ send_packet(mac_callback_t sent, void *ptr)
 static void
 input_packet(void)
 {
+#if CHANNEL_ESTIMATOR_ENABLED
+  uint8_t channel;
+
+  /* Without a stamp from the radio, the frame came in on our channel */
+  channel = packetbuf_attr(PACKETBUF_ATTR_RX_CHANNEL);
+  if(channel == 0) {
+    channel = LISTENING_CHANNEL;
+  }
+  channel_estimator_rx(packetbuf_addr(PACKETBUF_ADDR_SENDER), channel);
+#endif /* CHANNEL_ESTIMATOR_ENABLED */
   NETSTACK_NETWORK.input();
 }
 /*---------------------------------------------------------------------------*/
@@ -429,12 +549,26 @@ channel_check_interval(void)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+unsigned long
+csma_channel_switches_avoided(void)
+{
+#if CSMA_CHANNEL_GROUPING
+  return switches_avoided;
+#else /* CSMA_CHANNEL_GROUPING */
+  return 0;
+#endif /* CSMA_CHANNEL_GROUPING */
+}
+/*---------------------------------------------------------------------------*/
 static void
 init(void)
 {
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
   memb_init(&neighbor_memb);
+  retx_table_init();
+#if CHANNEL_ESTIMATOR_ENABLED
+  channel_estimator_init();
+#endif /* CHANNEL_ESTIMATOR_ENABLED */
 }
 /*---------------------------------------------------------------------------*/
 const struct mac_driver csma_driver = {
@@ -48,4 +48,8 @@ extern const struct mac_driver csma_driver;
 
 const struct mac_driver *csma_init(const struct mac_driver *r);
 
+/* Number of radio channel switches saved by serving queued packets
+   grouped by destination channel (CSMA_CONF_CHANNEL_GROUPING) */
+unsigned long csma_channel_switches_avoided(void);
+
 #endif /* __CSMA_H__ */
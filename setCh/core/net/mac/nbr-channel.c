@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Link-layer address keyed cache of the channel each neighbor
+ *         listens on. Entries live in a neighbor table, so a lookup is
+ *         a single key index search on the full link-layer address.
+ */
+
+#include "net/mac/nbr-channel.h"
+#include "net/nbr-table.h"
+
+struct nbr_channel {
+  uint8_t channel;
+  /* Unacknowledged transmissions in a row */
+  uint8_t failures;
+};
+
+NBR_TABLE(struct nbr_channel, nbr_channels);
+
+static uint8_t initialized;
+
+/* The entry of the last neighbor we looked up. Retransmissions and
+   bursts go to the same receiver, so this avoids the key search for
+   most frames on the strobe path. */
+static struct nbr_channel *last;
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+/*---------------------------------------------------------------------------*/
+static void
+entry_removed(nbr_table_item_t *item)
+{
+  if(item == last) {
+    last = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct nbr_channel *
+lookup(const rimeaddr_t *lladdr)
+{
+  struct nbr_channel *e;
+
+  if(last != NULL &&
+     rimeaddr_cmp(nbr_table_get_lladdr(nbr_channels, last), lladdr)) {
+    return last;
+  }
+  e = nbr_table_get_from_lladdr(nbr_channels, lladdr);
+  if(e != NULL) {
+    last = e;
+  }
+  return e;
+}
+/*---------------------------------------------------------------------------*/
+int
+nbr_channel_set(const rimeaddr_t *lladdr, uint8_t channel)
+{
+  struct nbr_channel *e;
+
+  if(!initialized || lladdr == NULL ||
+     rimeaddr_cmp(lladdr, &rimeaddr_null)) {
+    return 0;
+  }
+
+  e = lookup(lladdr);
+  if(e == NULL) {
+    e = nbr_table_add_lladdr(nbr_channels, lladdr);
+    if(e == NULL) {
+      PRINTF("nbr-channel: no room for %d.%d\n", lladdr->u8[0], lladdr->u8[1]);
+      return 0;
+    }
+    last = e;
+    e->failures = 0;
+  }
+  e->channel = channel;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+nbr_channel_get(const rimeaddr_t *lladdr)
+{
+  struct nbr_channel *e;
+
+  if(!initialized || lladdr == NULL) {
+    return NBR_CHANNEL_UNKNOWN;
+  }
+  e = lookup(lladdr);
+  return e != NULL ? e->channel : NBR_CHANNEL_UNKNOWN;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+nbr_channel_tx(const rimeaddr_t *lladdr, int acked)
+{
+  struct nbr_channel *e;
+
+  if(!initialized || lladdr == NULL ||
+     rimeaddr_cmp(lladdr, &rimeaddr_null)) {
+    return 0;
+  }
+
+  e = lookup(lladdr);
+  if(e == NULL) {
+    if(acked || !nbr_channel_set(lladdr, NBR_CHANNEL_UNKNOWN)) {
+      return 0;
+    }
+    e = last;
+  }
+  if(acked) {
+    e->failures = 0;
+  } else if(e->failures < 0xff) {
+    e->failures++;
+  }
+  return e->failures;
+}
+/*---------------------------------------------------------------------------*/
+void
+nbr_channel_remove(const rimeaddr_t *lladdr)
+{
+  struct nbr_channel *e;
+
+  if(!initialized || lladdr == NULL) {
+    return;
+  }
+  e = lookup(lladdr);
+  if(e != NULL) {
+    entry_removed(e);
+    nbr_table_remove(nbr_channels, e);
+  }
+}
+/*---------------------------------------------------------------------------*/
+const rimeaddr_t *
+nbr_channel_next(const rimeaddr_t *prev, uint8_t *channel)
+{
+  struct nbr_channel *e;
+
+  if(!initialized) {
+    return NULL;
+  }
+  if(prev == NULL) {
+    e = nbr_table_head(nbr_channels);
+  } else {
+    e = lookup(prev);
+    if(e == NULL) {
+      return NULL;
+    }
+    e = nbr_table_next(nbr_channels, e);
+  }
+  if(e == NULL) {
+    return NULL;
+  }
+  *channel = e->channel;
+  return nbr_table_get_lladdr(nbr_channels, e);
+}
+/*---------------------------------------------------------------------------*/
+void
+nbr_channel_init(void)
+{
+  /* Both the RDC layer and the IPv6 neighbor cache initialize us,
+     the table must only be registered once. */
+  if(!initialized) {
+    initialized = nbr_table_register(nbr_channels, entry_removed);
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -43,6 +43,9 @@
 #include "sys/ctimer.h"
 #include "net/queuebuf.h"
 #include "net/nbr-table.h"
+#include "net/mac/nbr-channel.h"
+
+#include <string.h>
 
 #if PHASE_CONF_DRIFT_CORRECT
 #define PHASE_DRIFT_CORRECT PHASE_CONF_DRIFT_CORRECT
@@ -50,6 +53,15 @@
 #define PHASE_DRIFT_CORRECT 0
 #endif
 
+/* When a neighbor moves to another channel, keep its phase as a
+   tentative one (the wake-up schedule does not depend on the channel)
+   instead of dropping it */
+#ifdef PHASE_CONF_CHANNEL_REANCHOR
+#define PHASE_CHANNEL_REANCHOR PHASE_CONF_CHANNEL_REANCHOR
+#else
+#define PHASE_CHANNEL_REANCHOR 1
+#endif
+
 struct phase {
   rtimer_clock_t time;
 #if PHASE_DRIFT_CORRECT
@@ -57,8 +69,18 @@ struct phase {
 #endif
   uint8_t noacks;
   struct timer noacks_timer;
+  /* The channel the neighbor listened on when the phase was learned */
+  uint8_t channel;
+  /* Set after a channel change until the phase is confirmed again */
+  uint8_t tentative;
+  /* The wake-up counter of the neighbor at clock time wakeup_time */
+  uint8_t has_wakeup;
+  uint16_t wakeup;
+  clock_time_t wakeup_time;
 };
 
+struct phase_stats phase_stats;
+
 struct phase_queueitem {
   struct ctimer timer;
   mac_callback_t mac_callback;
@@ -87,6 +109,42 @@ NBR_TABLE(struct phase, nbr_phase);
 #define PRINTDEBUG(...)
 #endif
 /*---------------------------------------------------------------------------*/
+/* Checks an entry against the channel the neighbor listens on now.
+   Returns the entry, or NULL if it was dropped. */
+static struct phase *
+check_channel(struct phase *e, const rimeaddr_t *neighbor)
+{
+  uint8_t channel;
+
+  channel = nbr_channel_get(neighbor);
+  if(e == NULL || e->channel == channel) {
+    return e;
+  }
+  if(e->channel == NBR_CHANNEL_UNKNOWN) {
+    /* Learned before the channel was known, nothing to correct */
+    e->channel = channel;
+    return e;
+  }
+
+  phase_stats.channel_changes++;
+  PRINTF("phase: %d.%d moved from channel %d to %d\n",
+         neighbor->u8[0], neighbor->u8[1], e->channel, channel);
+#if PHASE_CHANNEL_REANCHOR
+  /* The drift was measured on the old channel and the phase may not
+     hold anymore, so a single missed ack drops it */
+#if PHASE_DRIFT_CORRECT
+  e->drift = 0;
+#endif
+  e->noacks = 0;
+  e->channel = channel;
+  e->tentative = 1;
+  return e;
+#else /* PHASE_CHANNEL_REANCHOR */
+  nbr_table_remove(nbr_phase, e);
+  return NULL;
+#endif /* PHASE_CHANNEL_REANCHOR */
+}
+/*---------------------------------------------------------------------------*/
 void
 phase_update(const rimeaddr_t *neighbor, rtimer_clock_t time,
              int mac_status)
@@ -94,13 +152,16 @@ phase_update(const rimeaddr_t *neighbor, rtimer_clock_t time,
   struct phase *e;
 
   /* If we have an entry for this neighbor already, we renew it. */
-  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  e = check_channel(nbr_table_get_from_lladdr(nbr_phase, neighbor), neighbor);
   if(e != NULL) {
     if(mac_status == MAC_TX_OK) {
 #if PHASE_DRIFT_CORRECT
-      e->drift = time-e->time;
+      if(!e->tentative) {
+        e->drift = time-e->time;
+      }
 #endif
       e->time = time;
+      e->tentative = 0;
     }
     /* If the neighbor didn't reply to us, it may have switched
        phase (rebooted). We try a number of transmissions to it
@@ -111,8 +172,10 @@ phase_update(const rimeaddr_t *neighbor, rtimer_clock_t time,
       if(e->noacks == 1) {
         timer_set(&e->noacks_timer, MAX_NOACKS_TIME);
       }
-      if(e->noacks >= MAX_NOACKS || timer_expired(&e->noacks_timer)) {
+      if(e->noacks >= MAX_NOACKS || timer_expired(&e->noacks_timer) ||
+         e->tentative) {
         PRINTF("drop %d\n", neighbor->u8[0]);
+        phase_stats.drops++;
         nbr_table_remove(nbr_phase, e);
         return;
       }
@@ -129,11 +192,63 @@ phase_update(const rimeaddr_t *neighbor, rtimer_clock_t time,
       e->drift = 0;
 #endif
       e->noacks = 0;
+      e->channel = nbr_channel_get(neighbor);
+      e->tentative = 0;
+      e->has_wakeup = 0;
       }
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+int
+phase_known(const rimeaddr_t *neighbor)
+{
+  return nbr_table_get_from_lladdr(nbr_phase, neighbor) != NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+phase_set_wakeup(const rimeaddr_t *neighbor, clock_time_t time,
+                 uint16_t wakeup)
+{
+  struct phase *e;
+
+  /* Only neighbors we have a phase for, the counter alone does not
+     tell when to transmit */
+  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  if(e != NULL) {
+    e->wakeup = wakeup;
+    e->wakeup_time = time;
+    e->has_wakeup = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+phase_get_wakeup(const rimeaddr_t *neighbor, clock_time_t time,
+                 clock_time_t cycle_time, uint16_t *wakeup)
+{
+  struct phase *e;
+
+  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  if(e == NULL || !e->has_wakeup || cycle_time == 0) {
+    return 0;
+  }
+  *wakeup = e->wakeup +
+    (uint16_t)((clock_time_t)(time - e->wakeup_time + cycle_time / 2) /
+               cycle_time);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+phase_forget_wakeup(const rimeaddr_t *neighbor)
+{
+  struct phase *e;
+
+  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  if(e != NULL) {
+    e->has_wakeup = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
 static void
 send_packet(void *ptr)
 {
@@ -162,7 +277,12 @@ phase_wait(const rimeaddr_t *neighbor, rtimer_clock_t cycle_time,
      phase for this particular neighbor. If so, we can compute the
      time for the next expected phase and setup a ctimer to switch on
      the radio just before the phase. */
-  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  e = check_channel(nbr_table_get_from_lladdr(nbr_phase, neighbor), neighbor);
+  if(e == NULL) {
+    phase_stats.misses++;
+  } else {
+    phase_stats.hits++;
+  }
   if(e != NULL) {
     rtimer_clock_t wait, now, expected, sync;
     clock_time_t ctimewait;
@@ -242,5 +362,6 @@ phase_init(void)
 {
   memb_init(&queued_packets_memb);
   nbr_table_register(nbr_phase, NULL);
+  memset(&phase_stats, 0, sizeof(phase_stats));
 }
 /*---------------------------------------------------------------------------*/
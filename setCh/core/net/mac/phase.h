@@ -53,6 +53,17 @@ typedef enum {
   PHASE_DEFERRED,
 } phase_status_t;
 
+struct phase_stats {
+  /* phase_wait() calls with and without a known phase */
+  unsigned long hits, misses;
+  /* Phases re-anchored or dropped because the neighbor changed channel */
+  unsigned long channel_changes;
+  /* Phases dropped after missed acks */
+  unsigned long drops;
+};
+
+extern struct phase_stats phase_stats;
+
 
 void phase_init(void);
 phase_status_t phase_wait(const rimeaddr_t *neighbor,
@@ -62,5 +73,16 @@ phase_status_t phase_wait(const rimeaddr_t *neighbor,
 void phase_update(const rimeaddr_t *neighbor,
                   rtimer_clock_t time, int mac_status);
 void phase_remove(const rimeaddr_t *neighbor);
+int phase_known(const rimeaddr_t *neighbor);
+
+/* The wake-up counter of a neighbor with a known phase, for channel
+   hopping. phase_set_wakeup() records that the neighbor woke up for
+   the wakeup-th time at clock time time. phase_get_wakeup() returns 1
+   and the number of the wake-up closest to time if it is known. */
+void phase_set_wakeup(const rimeaddr_t *neighbor, clock_time_t time,
+                      uint16_t wakeup);
+int phase_get_wakeup(const rimeaddr_t *neighbor, clock_time_t time,
+                     clock_time_t cycle_time, uint16_t *wakeup);
+void phase_forget_wakeup(const rimeaddr_t *neighbor);
 
 #endif /* PHASE_H */
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Background energy-detect survey of channels 11-26
+ */
+
+#include "net/mac/spectrum-survey.h"
+#include "dev/cc2420.h"
+#include "sys/energest.h"
+
+#include <string.h>
+
+/* Samples above this level count the channel as busy, by default the
+   CC2420 CCA threshold */
+#ifdef SPECTRUM_SURVEY_CONF_BUSY_THRESHOLD
+#define BUSY_THRESHOLD SPECTRUM_SURVEY_CONF_BUSY_THRESHOLD
+#else
+#define BUSY_THRESHOLD -77
+#endif
+
+/* The CC2420 RSSI register reads 45 above the level in dBm */
+#define RSSI_OFFSET -45
+
+struct channel_survey {
+  int8_t floor;
+  uint8_t occupancy;
+  uint8_t samples;
+};
+
+static struct channel_survey survey[SPECTRUM_SURVEY_NUM_CHANNELS];
+static uint8_t next;
+/*---------------------------------------------------------------------------*/
+void
+spectrum_survey_init(void)
+{
+  memset(survey, 0, sizeof(survey));
+  next = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_sample(struct channel_survey *s, int dbm)
+{
+  if(s->samples == 0) {
+    s->floor = dbm;
+    s->occupancy = dbm > BUSY_THRESHOLD ? 255 : 0;
+    s->samples = 1;
+    return;
+  }
+
+  /* The floor follows a lower sample at once and rises slowly, so
+     that bursts of traffic do not lift it */
+  if(dbm < s->floor) {
+    s->floor = dbm;
+  } else {
+    s->floor += (dbm - s->floor + 15) / 16;
+  }
+  s->occupancy = ((uint16_t)s->occupancy * 7 +
+                  (dbm > BUSY_THRESHOLD ? 255 : 0)) / 8;
+  if(s->samples < 255) {
+    s->samples++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+spectrum_survey_sample(void)
+{
+  int channel, rssi;
+
+  channel = cc2420_get_channel();
+  /* Keep the two retunes out of the channel switch count. Trees
+     without per-channel energest do not define the macro. */
+#ifdef ENERGEST_CHANNEL_SURVEY
+  ENERGEST_CHANNEL_SURVEY(1);
+#endif
+  cc2420_set_channel(SPECTRUM_SURVEY_FIRST_CHANNEL + next);
+  rssi = cc2420_rssi();
+  cc2420_set_channel(channel);
+#ifdef ENERGEST_CHANNEL_SURVEY
+  ENERGEST_CHANNEL_SURVEY(0);
+#endif
+
+  /* cc2420_rssi() returns 0 when the radio is locked by an ongoing
+     operation; a real reading of 0 (-45 dBm) is not worth keeping */
+  if(rssi != 0) {
+    add_sample(&survey[next], rssi + RSSI_OFFSET);
+  }
+  next = (next + 1) % SPECTRUM_SURVEY_NUM_CHANNELS;
+}
+/*---------------------------------------------------------------------------*/
+int
+spectrum_survey_noise_floor(uint8_t channel)
+{
+  if(channel < SPECTRUM_SURVEY_FIRST_CHANNEL ||
+     channel > SPECTRUM_SURVEY_LAST_CHANNEL) {
+    return 0;
+  }
+  return survey[channel - SPECTRUM_SURVEY_FIRST_CHANNEL].floor;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+spectrum_survey_occupancy(uint8_t channel)
+{
+  if(channel < SPECTRUM_SURVEY_FIRST_CHANNEL ||
+     channel > SPECTRUM_SURVEY_LAST_CHANNEL) {
+    return 0;
+  }
+  return survey[channel - SPECTRUM_SURVEY_FIRST_CHANNEL].occupancy;
+}
+/*---------------------------------------------------------------------------*/
+void
+spectrum_survey_pack(uint8_t *report)
+{
+  int c, bin;
+
+  for(c = 0; c < SPECTRUM_SURVEY_NUM_CHANNELS; c++) {
+    bin = (survey[c].floor - SPECTRUM_SURVEY_FLOOR_MIN) /
+      SPECTRUM_SURVEY_FLOOR_STEP;
+    if(survey[c].samples == 0 || bin < 0) {
+      bin = 0;
+    } else if(bin > 15) {
+      bin = 15;
+    }
+    report[c] = (survey[c].occupancy & 0xf0) | bin;
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -46,13 +46,28 @@ typedef struct nbr_table_key {
   rimeaddr_t lladdr;
 } nbr_table_key_t;
 
-/* For each neighbor, a map of the tables that use the neighbor.
- * As we are using uint8_t, we have a maximum of 8 tables in the system */
-static uint8_t used_map[NBR_TABLE_MAX_NEIGHBORS];
-/* For each neighbor, a map of the tables that lock the neighbor */
-static uint8_t locked_map[NBR_TABLE_MAX_NEIGHBORS];
 /* The maximum number of tables */
-#define MAX_NUM_TABLES 8
+#ifdef NBR_TABLE_CONF_MAX_NUM_TABLES
+#define MAX_NUM_TABLES NBR_TABLE_CONF_MAX_NUM_TABLES
+#else /* NBR_TABLE_CONF_MAX_NUM_TABLES */
+#define MAX_NUM_TABLES 16
+#endif /* NBR_TABLE_CONF_MAX_NUM_TABLES */
+
+/* One bit per table */
+#if MAX_NUM_TABLES <= 8
+typedef uint8_t nbr_table_bitmap_t;
+#elif MAX_NUM_TABLES <= 16
+typedef uint16_t nbr_table_bitmap_t;
+#elif MAX_NUM_TABLES <= 32
+typedef uint32_t nbr_table_bitmap_t;
+#else
+#error NBR_TABLE_CONF_MAX_NUM_TABLES must be at most 32
+#endif
+
+/* For each neighbor, a map of the tables that use the neighbor */
+static nbr_table_bitmap_t used_map[NBR_TABLE_MAX_NEIGHBORS];
+/* For each neighbor, a map of the tables that lock the neighbor */
+static nbr_table_bitmap_t locked_map[NBR_TABLE_MAX_NEIGHBORS];
 /* A list of pointers to tables in use */
 static struct nbr_table *all_tables[MAX_NUM_TABLES];
 /* The current number of tables */
@@ -62,6 +77,22 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+/* Open-addressed hash index over the keys, with linear probing. A slot
+ * holds the neighbor index + 1, or 0 when empty. Keeping the table at
+ * most half full keeps the probe sequences short. */
+#ifdef NBR_TABLE_CONF_HASH_SIZE
+#define NBR_TABLE_HASH_SIZE NBR_TABLE_CONF_HASH_SIZE
+#else /* NBR_TABLE_CONF_HASH_SIZE */
+#define NBR_TABLE_HASH_SIZE (2 * NBR_TABLE_MAX_NEIGHBORS + 1)
+#endif /* NBR_TABLE_CONF_HASH_SIZE */
+
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t nbr_table_hash_slot_t;
+#else
+typedef uint16_t nbr_table_hash_slot_t;
+#endif
+static nbr_table_hash_slot_t hash_index[NBR_TABLE_HASH_SIZE];
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -105,33 +136,89 @@ key_from_item(nbr_table_t *table, nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+/* Get the home slot of a link-layer address in the hash index */
+static int
+hash_slot(const rimeaddr_t *lladdr)
+{
+  uint16_t h = 0;
+  int i;
+  for(i = 0; i < RIMEADDR_SIZE; i++) {
+    h = (h << 5) + h + lladdr->u8[i];
+  }
+  return h % NBR_TABLE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+/* Add a key to the hash index */
+static void
+hash_insert(nbr_table_key_t *key)
+{
+  int slot = hash_slot(&key->lladdr);
+  while(hash_index[slot] != 0) {
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  hash_index[slot] = index_from_key(key) + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a key from the hash index. The entries that follow it in the
+ * same probe run are moved back, so that no lookup stops too early. */
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  int slot, next, home;
+  nbr_table_hash_slot_t entry = index_from_key(key) + 1;
+
+  slot = hash_slot(&key->lladdr);
+  while(hash_index[slot] != entry) {
+    if(hash_index[slot] == 0) {
+      return;
+    }
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  hash_index[slot] = 0;
+
+  next = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  while(hash_index[next] != 0) {
+    home = hash_slot(&key_from_index(hash_index[next] - 1)->lladdr);
+    /* Move the entry into the hole unless its home slot lies
+     * cyclically in (slot, next] */
+    if((slot < next) ? (home <= slot || home > next)
+                     : (home <= slot && home > next)) {
+      hash_index[slot] = hash_index[next];
+      hash_index[next] = 0;
+      slot = next;
+    }
+    next = (next + 1) % NBR_TABLE_HASH_SIZE;
+  }
+}
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const rimeaddr_t *lladdr)
 {
-  nbr_table_key_t *key;
+  int slot;
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by rimeaddr_null. */
   if(lladdr == NULL) {
     lladdr = &rimeaddr_null;
   }
-  key = list_head(nbr_table_keys);
-  while(key != NULL) {
-    if(lladdr && rimeaddr_cmp(lladdr, &key->lladdr)) {
-      return index_from_key(key);
+  slot = hash_slot(lladdr);
+  while(hash_index[slot] != 0) {
+    int index = hash_index[slot] - 1;
+    if(rimeaddr_cmp(lladdr, &key_from_index(index)->lladdr)) {
+      return index;
     }
-    key = list_item_next(key);
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
   }
   return -1;
 }
 /*---------------------------------------------------------------------------*/
 /* Get bit from "used" or "locked" bitmap */
 static int
-nbr_get_bit(uint8_t *bitmap, nbr_table_t *table, nbr_table_item_t *item)
+nbr_get_bit(nbr_table_bitmap_t *bitmap, nbr_table_t *table, nbr_table_item_t *item)
 {
   int item_index = index_from_item(table, item);
   if(table != NULL && item_index != -1) {
-    return (bitmap[item_index] & (1 << table->index)) != 0;
+    return (bitmap[item_index] & ((nbr_table_bitmap_t)1 << table->index)) != 0;
   } else {
     return 0;
   }
@@ -140,14 +227,14 @@ nbr_get_bit(uint8_t *bitmap, nbr_table_t *table, nbr_table_item_t *item)
 /*---------------------------------------------------------------------------*/
 /* Set bit in "used" or "locked" bitmap */
 static int
-nbr_set_bit(uint8_t *bitmap, nbr_table_t *table, nbr_table_item_t *item, int value)
+nbr_set_bit(nbr_table_bitmap_t *bitmap, nbr_table_t *table, nbr_table_item_t *item, int value)
 {
   int item_index = index_from_item(table, item);
   if(table != NULL && item_index != -1) {
     if(value) {
-      bitmap[item_index] |= 1 << table->index;
+      bitmap[item_index] |= (nbr_table_bitmap_t)1 << table->index;
     } else {
-      bitmap[item_index] &= ~(1 << table->index);
+      bitmap[item_index] &= ~((nbr_table_bitmap_t)1 << table->index);
     }
     return 1;
   } else {
@@ -176,10 +263,10 @@ nbr_table_allocate(void)
     key = list_head(nbr_table_keys);
     while(key != NULL) {
       int item_index = index_from_key(key);
-      int locked = locked_map[item_index];
+      nbr_table_bitmap_t locked = locked_map[item_index];
       /* Never delete a locked item */
       if(!locked) {
-        int used = used_map[item_index];
+        nbr_table_bitmap_t used = used_map[item_index];
         int used_count = 0;
         /* Count how many tables are using this item */
         while(used != 0) {
@@ -216,8 +303,9 @@ nbr_table_allocate(void)
       }
       /* Empty used map */
       used_map[index_from_key(least_used_key)] = 0;
-      /* Remove neighbor from list */
+      /* Remove neighbor from list and from the hash index */
       list_remove(nbr_table_keys, least_used_key);
+      hash_remove(least_used_key);
       /* Return associated key */
       return least_used_key;
     }
@@ -298,6 +386,7 @@ nbr_table_add_lladdr(nbr_table_t *table, const rimeaddr_t *lladdr)
 
     /* Set link-layer address */
     rimeaddr_copy(&key->lladdr, lladdr);
+    hash_insert(key);
   }
 
   /* Get item in the current table */
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Per-neighbor retransmission statistics
+ */
+
+#include "net/retx-table.h"
+#include "net/nbr-table.h"
+#include "net/mac/mac.h"
+
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else /* DEBUG */
+#define PRINTF(...)
+#endif /* DEBUG */
+
+struct retx_outcome {
+  uint8_t transmissions;
+  uint8_t collisions;
+  uint8_t acked;
+};
+
+struct retx_entry {
+  struct retx_outcome ring[RETX_TABLE_WINDOW];
+  uint8_t head;
+  uint8_t count;
+  uint8_t degraded;
+};
+
+NBR_TABLE(struct retx_entry, retx_entries);
+
+process_event_t retx_table_event;
+
+static rimeaddr_t event_addr;
+static uint8_t initialized;
+/*---------------------------------------------------------------------------*/
+void
+retx_table_init(void)
+{
+  if(!initialized) {
+    initialized = nbr_table_register(retx_entries, NULL);
+    if(initialized) {
+      retx_table_event = process_alloc_event();
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sum(const struct retx_entry *e, struct retx_stats *stats)
+{
+  int i;
+
+  memset(stats, 0, sizeof(struct retx_stats));
+  for(i = 0; i < e->count; i++) {
+    stats->transmissions += e->ring[i].transmissions;
+    stats->collisions += e->ring[i].collisions;
+    stats->acked += e->ring[i].acked;
+  }
+  stats->packets = e->count;
+}
+/*---------------------------------------------------------------------------*/
+/* A link is judged once half of the window is filled */
+static int
+is_degraded(const struct retx_stats *stats)
+{
+  if(stats->packets < (RETX_TABLE_WINDOW + 1) / 2) {
+    return 0;
+  }
+  return (stats->transmissions + stats->collisions) * 16 >
+    (uint16_t)RETX_TABLE_TX_THRESHOLD * stats->packets ||
+    stats->acked * 100 < RETX_TABLE_ACK_THRESHOLD * stats->packets;
+}
+/*---------------------------------------------------------------------------*/
+void
+retx_table_record(const rimeaddr_t *addr, int status,
+                  uint8_t transmissions, uint8_t collisions)
+{
+  struct retx_entry *e;
+  struct retx_stats stats;
+
+  if(!initialized || rimeaddr_cmp(addr, &rimeaddr_null)) {
+    return;
+  }
+  if(status != MAC_TX_OK && status != MAC_TX_NOACK &&
+     status != MAC_TX_COLLISION) {
+    return;
+  }
+
+  e = nbr_table_get_from_lladdr(retx_entries, addr);
+  if(e == NULL) {
+    e = nbr_table_add_lladdr(retx_entries, addr);
+    if(e == NULL) {
+      return;
+    }
+    memset(e, 0, sizeof(struct retx_entry));
+  }
+
+  e->ring[e->head].transmissions = transmissions;
+  e->ring[e->head].collisions = collisions;
+  e->ring[e->head].acked = status == MAC_TX_OK;
+  e->head = (e->head + 1) % RETX_TABLE_WINDOW;
+  if(e->count < RETX_TABLE_WINDOW) {
+    e->count++;
+  }
+
+  sum(e, &stats);
+  if(is_degraded(&stats)) {
+    /* Raise the event once, when the link crosses the threshold */
+    if(!e->degraded) {
+      e->degraded = 1;
+      rimeaddr_copy(&event_addr, addr);
+      PRINTF("retx-table: link to %d.%d degraded, %u tx %u col %u acked of %u\n",
+             addr->u8[6], addr->u8[7], stats.transmissions,
+             stats.collisions, stats.acked, stats.packets);
+      process_post(PROCESS_BROADCAST, retx_table_event, &event_addr);
+    }
+  } else {
+    e->degraded = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+retx_table_get(const rimeaddr_t *addr, struct retx_stats *stats)
+{
+  struct retx_entry *e;
+
+  if(!initialized) {
+    return 0;
+  }
+  e = nbr_table_get_from_lladdr(retx_entries, addr);
+  if(e == NULL || e->count == 0) {
+    return 0;
+  }
+  sum(e, stats);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+retx_table_avg_transmissions(const rimeaddr_t *addr)
+{
+  struct retx_stats stats;
+
+  if(!retx_table_get(addr, &stats)) {
+    return 0;
+  }
+  return ((stats.transmissions + stats.collisions) * 16) / stats.packets;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+retx_table_ack_ratio(const rimeaddr_t *addr)
+{
+  struct retx_stats stats;
+
+  if(!retx_table_get(addr, &stats)) {
+    return 100;
+  }
+  return (stats.acked * 100) / stats.packets;
+}
+/*---------------------------------------------------------------------------*/
+void
+retx_table_clear(const rimeaddr_t *addr)
+{
+  struct retx_entry *e;
+
+  if(!initialized) {
+    return;
+  }
+  e = nbr_table_get_from_lladdr(retx_entries, addr);
+  if(e != NULL) {
+    memset(e, 0, sizeof(struct retx_entry));
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Per-neighbor retransmission statistics. CSMA records the
+ *         outcome of every unicast packet in a small ring per neighbor;
+ *         when the windowed averages cross a threshold, retx_table_event
+ *         is broadcast so that the application can ask for a new channel.
+ */
+
+#ifndef RETX_TABLE_H
+#define RETX_TABLE_H
+
+#include "contiki.h"
+#include "net/rime/rimeaddr.h"
+
+/* Packets kept per neighbor */
+#ifdef RETX_TABLE_CONF_WINDOW
+#define RETX_TABLE_WINDOW RETX_TABLE_CONF_WINDOW
+#else
+#define RETX_TABLE_WINDOW 8
+#endif
+
+/* Average transmissions per packet, in sixteenths, above which the link
+   to a neighbor counts as degraded */
+#ifdef RETX_TABLE_CONF_TX_THRESHOLD
+#define RETX_TABLE_TX_THRESHOLD RETX_TABLE_CONF_TX_THRESHOLD
+#else
+#define RETX_TABLE_TX_THRESHOLD (3 * 16)
+#endif
+
+/* Percentage of acknowledged packets below which the link counts as
+   degraded */
+#ifdef RETX_TABLE_CONF_ACK_THRESHOLD
+#define RETX_TABLE_ACK_THRESHOLD RETX_TABLE_CONF_ACK_THRESHOLD
+#else
+#define RETX_TABLE_ACK_THRESHOLD 75
+#endif
+
+struct retx_stats {
+  uint8_t packets;
+  uint8_t acked;
+  uint16_t transmissions;
+  uint16_t collisions;
+};
+
+/* Broadcast to all processes when a neighbor's link becomes degraded.
+   The data pointer is the neighbor's link-layer address, valid until
+   the next event. */
+extern process_event_t retx_table_event;
+
+void retx_table_init(void);
+void retx_table_record(const rimeaddr_t *addr, int status,
+                       uint8_t transmissions, uint8_t collisions);
+
+/* Sums over the window; returns 0 if nothing is known about addr */
+int retx_table_get(const rimeaddr_t *addr, struct retx_stats *stats);
+/* Average transmissions per packet in sixteenths, 0 if unknown */
+uint16_t retx_table_avg_transmissions(const rimeaddr_t *addr);
+/* Percentage of acknowledged packets, 100 if unknown */
+uint8_t retx_table_ack_ratio(const rimeaddr_t *addr);
+
+/* Forget the history of addr, e.g. after it changed channel */
+void retx_table_clear(const rimeaddr_t *addr);
+
+#endif /* RETX_TABLE_H */
@@ -52,6 +52,13 @@
 //ADILA EDIT
 static clock_time_t start_time;
 
+/* Multicast DIOs go out on this channel, see contikimac send_packet() */
+#ifdef RPL_CONF_BROADCAST_CHANNEL
+#define RPL_BROADCAST_CHANNEL RPL_CONF_BROADCAST_CHANNEL
+#else
+#define RPL_BROADCAST_CHANNEL 26
+#endif
+
 /*---------------------------------------------------------------------------*/
 static struct ctimer periodic_timer;
 
@@ -167,8 +174,11 @@ handle_dio_timer(void *ptr)
 
         for(nbr = nbr_table_head(ds6_neighbors); nbr != NULL;
           nbr = nbr_table_next(ds6_neighbors,nbr)) {
-	  /* Sending DIO as unicast */
-	  dio_output(instance, &nbr->ipaddr);
+	  /* Sending DIO as unicast, only to the neighbours that do not
+	     hear the multicast on the broadcast channel */
+	  if(nbr->nbrCh != RPL_BROADCAST_CHANNEL) {
+	    dio_output(instance, &nbr->ipaddr);
+	  }
 	}//for()
 
 	/* Sending DIO as multicast */
@@ -841,6 +841,8 @@ tcpip_uipcall(void)
 PROCESS_THREAD(tcpip_process, ev, data)
 {
   PROCESS_BEGIN();
+
+  process_set_priority(&tcpip_process, PROCESS_PRIORITY_HIGH);
   
 #if UIP_TCP
  {
@@ -50,6 +50,7 @@
 #include "net/rime/rimeaddr.h"
 #include "net/packetbuf.h"
 #include "net/uip-ds6-nbr.h"
+#include "net/mac/nbr-channel.h"
 
 #define DEBUG DEBUG_NONE
 #include "net/uip-debug.h"
@@ -75,6 +76,7 @@ void
 uip_ds6_neighbors_init(void)
 {
   nbr_table_register(ds6_neighbors, (nbr_table_callback *)uip_ds6_nbr_rm);
+  nbr_channel_init();
 }
 /*---------------------------------------------------------------------------*/
 uip_ds6_nbr_t *
@@ -93,10 +95,12 @@ uip_ds6_nbr_add(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr,
     stimer_set(&nbr->reachable, 0);
     stimer_set(&nbr->sendns, 0);
     nbr->nscount = 0;
+    nbr->heardCh = 0;
+    nbr->heardCount = 0;
 
 //ADILA EDIT 18/02/15
 if(nbr->nbrCh == 0) {
-  nbr->nbrCh = 26;
+  uip_ds6_nbr_set_channel(nbr, 26);
 }
 //-------------------
 
@@ -131,6 +135,53 @@ uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr)
   return;
 }
 
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_nbr_set_channel(uip_ds6_nbr_t *nbr, uint8_t channel)
+{
+  if(nbr != NULL) {
+    nbr->nbrCh = channel;
+    /* Keep the MAC layer channel cache in step with the neighbor cache */
+    nbr_channel_set((rimeaddr_t *)uip_ds6_nbr_get_ll(nbr), channel);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Called for every received frame: the sender names the channel it
+   listens on, so a stale entry heals without an explicit announcement.
+   One stray frame does not move the entry. */
+void
+uip_ds6_nbr_channel_heard(void)
+{
+#if UIP_DS6_NBR_CHANNEL_CONFIDENCE
+  uip_ds6_nbr_t *nbr;
+  uint8_t channel;
+
+  channel = packetbuf_attr(PACKETBUF_ATTR_SENDER_CHANNEL);
+  if(channel == 0) {
+    return;
+  }
+  nbr = uip_ds6_nbr_ll_lookup((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  if(nbr == NULL) {
+    return;
+  }
+
+  if(channel == nbr->nbrCh) {
+    nbr->heardCh = channel;
+    nbr->heardCount = UIP_DS6_NBR_CHANNEL_CONFIDENCE;
+    return;
+  }
+  if(channel != nbr->heardCh) {
+    nbr->heardCh = channel;
+    nbr->heardCount = 0;
+  }
+  if(++nbr->heardCount >= UIP_DS6_NBR_CHANNEL_CONFIDENCE) {
+    PRINTF("uip-ds6-neighbor : ");
+    PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
+    PRINTF(" heard on channel %u\n", channel);
+    uip_ds6_nbr_set_channel(nbr, channel);
+  }
+#endif /* UIP_DS6_NBR_CHANNEL_CONFIDENCE */
+}
 /*---------------------------------------------------------------------------*/
 uip_ipaddr_t *
 uip_ds6_nbr_get_ipaddr(uip_ds6_nbr_t *nbr)
@@ -56,6 +56,14 @@
 #include "net/uip-packetqueue.h"
 #endif                          /*UIP_CONF_QUEUE_PKT */
 
+/* Frames in a row that must name another channel for a neighbor before
+   we believe it moved there. 0 turns learning from frames off. */
+#ifdef UIP_CONF_DS6_NBR_CHANNEL_CONFIDENCE
+#define UIP_DS6_NBR_CHANNEL_CONFIDENCE UIP_CONF_DS6_NBR_CHANNEL_CONFIDENCE
+#else
+#define UIP_DS6_NBR_CHANNEL_CONFIDENCE 2
+#endif
+
 /*--------------------------------------------------*/
 /** \brief Possible states for the nbr cache entries */
 #define  NBR_INCOMPLETE 0
@@ -79,6 +87,10 @@ typedef struct uip_ds6_nbr {
 uint8_t nbrCh;
 //uint8_t ackRecv;
 //-------------------
+  /* The channel the last frames of the neighbor named, and how many
+     in a row did */
+  uint8_t heardCh;
+  uint8_t heardCount;
 
 #if UIP_CONF_IPV6_QUEUE_PKT
   struct uip_packetqueue_handle packethandle;
@@ -94,11 +106,13 @@ uip_ds6_nbr_t *uip_ds6_nbr_add(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr,
 void uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr);
 uip_lladdr_t *uip_ds6_nbr_get_ll(uip_ds6_nbr_t *nbr);
 uip_ipaddr_t *uip_ds6_nbr_get_ipaddr(uip_ds6_nbr_t *nbr);
+void uip_ds6_nbr_set_channel(uip_ds6_nbr_t *nbr, uint8_t channel);
 uip_ds6_nbr_t *uip_ds6_nbr_lookup(uip_ipaddr_t *ipaddr);
 uip_ds6_nbr_t *uip_ds6_nbr_ll_lookup(uip_lladdr_t *lladdr);
 uip_ipaddr_t *uip_ds6_nbr_ipaddr_from_lladdr(uip_lladdr_t *lladdr);
 uip_lladdr_t *uip_ds6_nbr_lladdr_from_ipaddr(uip_ipaddr_t *ipaddr);
 void uip_ds6_link_neighbor_callback(int status, int numtx);
+void uip_ds6_nbr_channel_heard(void);
 void uip_ds6_neighbor_periodic(void);
 int uip_ds6_nbr_num(void);
 
@@ -52,7 +52,7 @@ NBR_TABLE(struct uip_ds6_route_neighbor_routes, nbr_routes);
    block. These routes are maintained on lists of route entries that
    are attached to each neighbor, via the nbr_routes neighbor
    table. */
-MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
+MEMB_FREELIST(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 
 /* Default routes are held on the defaultrouterlist and their
    structures are allocated from the defaultroutermemb memory block.*/
@@ -65,12 +65,114 @@ LIST(notificationlist);
 
 static int num_routes = 0;
 
+#if UIP_DS6_ROUTE_INDEX
+/* Hash table over the host routes, with linear probing */
+#define ROUTE_HASH_SIZE (2 * UIP_DS6_ROUTE_NB + 1)
+static uip_ds6_route_t *route_hash[ROUTE_HASH_SIZE];
+/* Routes that are not host routes, longest prefix first */
+static uip_ds6_route_t *prefix_routes;
+/* All routes, in the order they were added */
+static uip_ds6_route_t *route_first, *route_last;
+#endif /* UIP_DS6_ROUTE_INDEX */
+
 #undef DEBUG
 #define DEBUG DEBUG_NONE
 #include "net/uip-debug.h"
 
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 /*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_INDEX
+static int
+route_hash_slot(const uip_ipaddr_t *addr)
+{
+  uint16_t h = 0;
+  int i;
+  for(i = 0; i < sizeof(uip_ipaddr_t); i++) {
+    h = (h << 5) + h + addr->u8[i];
+  }
+  return h % ROUTE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+route_hash_lookup(const uip_ipaddr_t *addr)
+{
+  int slot = route_hash_slot(addr);
+  while(route_hash[slot] != NULL) {
+    if(uip_ipaddr_cmp(addr, &route_hash[slot]->ipaddr)) {
+      return route_hash[slot];
+    }
+    slot = (slot + 1) % ROUTE_HASH_SIZE;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_hash_rm(uip_ds6_route_t *r)
+{
+  int slot, next, home;
+
+  slot = route_hash_slot(&r->ipaddr);
+  while(route_hash[slot] != r) {
+    if(route_hash[slot] == NULL) {
+      return;
+    }
+    slot = (slot + 1) % ROUTE_HASH_SIZE;
+  }
+  route_hash[slot] = NULL;
+
+  /* Move back the entries that follow in the same probe run, unless
+     their home slot lies cyclically in (slot, next] */
+  next = (slot + 1) % ROUTE_HASH_SIZE;
+  while(route_hash[next] != NULL) {
+    home = route_hash_slot(&route_hash[next]->ipaddr);
+    if((slot < next) ? (home <= slot || home > next)
+                     : (home <= slot && home > next)) {
+      route_hash[slot] = route_hash[next];
+      route_hash[next] = NULL;
+      slot = next;
+    }
+    next = (next + 1) % ROUTE_HASH_SIZE;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Add a route to the hash table or to the prefix list, depending on
+   its prefix length */
+static void
+route_index_add(uip_ds6_route_t *r)
+{
+  if(r->length == 128) {
+    int slot = route_hash_slot(&r->ipaddr);
+    while(route_hash[slot] != NULL) {
+      slot = (slot + 1) % ROUTE_HASH_SIZE;
+    }
+    route_hash[slot] = r;
+  } else {
+    uip_ds6_route_t **p = &prefix_routes;
+    while(*p != NULL && (*p)->length >= r->length) {
+      p = &(*p)->prefix_next;
+    }
+    r->prefix_next = *p;
+    *p = r;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_index_rm(uip_ds6_route_t *r)
+{
+  if(r->length == 128) {
+    route_hash_rm(r);
+  } else {
+    uip_ds6_route_t **p = &prefix_routes;
+    while(*p != NULL && *p != r) {
+      p = &(*p)->prefix_next;
+    }
+    if(*p != NULL) {
+      *p = r->prefix_next;
+    }
+  }
+}
+#endif /* UIP_DS6_ROUTE_INDEX */
+/*---------------------------------------------------------------------------*/
 #if DEBUG != DEBUG_NONE
 static void
 assert_nbr_routes_list_sane(void)
@@ -146,6 +248,11 @@ uip_ds6_route_init(void)
   memb_init(&defaultroutermemb);
   list_init(defaultrouterlist);
 
+#if UIP_DS6_ROUTE_INDEX
+  memset(route_hash, 0, sizeof(route_hash));
+  prefix_routes = route_first = route_last = NULL;
+#endif /* UIP_DS6_ROUTE_INDEX */
+
 #if UIP_DS6_NOTIFICATIONS
   list_init(notificationlist);
 #endif
@@ -174,6 +281,9 @@ uip_ds6_route_nexthop(uip_ds6_route_t *route)
 uip_ds6_route_t *
 uip_ds6_route_head(void)
 {
+#if UIP_DS6_ROUTE_INDEX
+  return route_first;
+#else /* UIP_DS6_ROUTE_INDEX */
   struct uip_ds6_route_neighbor_routes *routes;
 
   routes = (struct uip_ds6_route_neighbor_routes *)nbr_table_head(nbr_routes);
@@ -185,11 +295,15 @@ uip_ds6_route_head(void)
   } else {
     return NULL;
   }
+#endif /* UIP_DS6_ROUTE_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 uip_ds6_route_t *
 uip_ds6_route_next(uip_ds6_route_t *r)
 {
+#if UIP_DS6_ROUTE_INDEX
+  return r != NULL ? r->index_next : NULL;
+#else /* UIP_DS6_ROUTE_INDEX */
   if(r != NULL) {
     uip_ds6_route_t *n = list_item_next(r);
     if(n != NULL) {
@@ -205,6 +319,7 @@ uip_ds6_route_next(uip_ds6_route_t *r)
   }
 
   return NULL;
+#endif /* UIP_DS6_ROUTE_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -218,7 +333,9 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
   uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_INDEX
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_INDEX */
 
 //ADILA EDIT 10/11/14
 //uint8_t found_route_ch;
@@ -229,6 +346,18 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
   PRINTF("\n");
 
 
+#if UIP_DS6_ROUTE_INDEX
+  /* A host route is the longest possible match, and the prefix list
+     is sorted so that the first match is the longest one. */
+  found_route = route_hash_lookup(addr);
+  for(r = prefix_routes;
+      found_route == NULL && r != NULL;
+      r = r->prefix_next) {
+    if(uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+      found_route = r;
+    }
+  }
+#else /* UIP_DS6_ROUTE_INDEX */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -244,6 +373,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
 //-------------------
     }
   }
+#endif /* UIP_DS6_ROUTE_INDEX */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -301,6 +431,10 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
     PRINTF("uip_ds6_route_add: old route already found, updating this one instead: ");
     PRINT6ADDR(ipaddr);
     PRINTF("\n");
+#if UIP_DS6_ROUTE_INDEX
+    /* The prefix may change, index the route again below */
+    route_index_rm(r);
+#endif /* UIP_DS6_ROUTE_INDEX */
   } else {
     struct uip_ds6_route_neighbor_routes *routes;
     /* If there is no routing entry, create one */
@@ -350,10 +484,24 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
     PRINTF("uip_ds6_route_add num %d\n", num_routes);
     r->routes = routes;
+
+#if UIP_DS6_ROUTE_INDEX
+    r->index_prev = route_last;
+    r->index_next = NULL;
+    if(route_last != NULL) {
+      route_last->index_next = r;
+    } else {
+      route_first = r;
+    }
+    route_last = r;
+#endif /* UIP_DS6_ROUTE_INDEX */
   }
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_INDEX
+  route_index_add(r);
+#endif /* UIP_DS6_ROUTE_INDEX */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -397,6 +545,19 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     PRINTF("\n");
 
     list_remove(route->routes->route_list, route);
+#if UIP_DS6_ROUTE_INDEX
+    route_index_rm(route);
+    if(route->index_prev != NULL) {
+      route->index_prev->index_next = route->index_next;
+    } else {
+      route_first = route->index_next;
+    }
+    if(route->index_next != NULL) {
+      route->index_next->index_prev = route->index_prev;
+    } else {
+      route_last = route->index_prev;
+    }
+#endif /* UIP_DS6_ROUTE_INDEX */
     if(list_head(route->routes->route_list) == NULL) {
       /* If this was the only route using this neighbor, remove the
          neibhor from the table */
@@ -65,6 +65,8 @@ PROCESS_THREAD(ctimer_process, ev, data)
   struct ctimer *c;
   PROCESS_BEGIN();
 
+  process_set_priority(&ctimer_process, PROCESS_PRIORITY_HIGH);
+
   for(c = list_head(ctimer_list); c != NULL; c = c->next) {
     etimer_set(&c->etimer, c->etimer.timer.interval);
   }
@@ -40,6 +40,8 @@
 #include "sys/energest.h"
 #include "contiki-conf.h"
 
+#include <string.h>
+
 #if ENERGEST_CONF_ON
 
 int energest_total_count;
@@ -50,6 +52,23 @@ energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVICE_LEVE
 #endif
 unsigned char energest_current_mode[ENERGEST_TYPE_MAX];
 
+#if ENERGEST_CHANNELS
+/* Receive time is kept in bytes and converted when read */
+static unsigned long channel_time[ENERGEST_CHANNEL_NUM][ENERGEST_CHANNEL_TYPE_MAX];
+/* Transmit and listen totals when we tuned to current_channel */
+static unsigned long channel_mark[2];
+static int current_channel;
+static unsigned long channel_switches;
+static unsigned long channel_settle_time;
+/* Retunes of the spectrum survey are counted apart, they are not
+   channel switches of the protocol */
+static uint8_t channel_surveying;
+static unsigned long channel_survey_switches;
+
+/* IEEE 802.15.4 at 2.4 GHz: 250 kbit/s */
+#define BYTES_PER_SECOND 31250UL
+#endif /* ENERGEST_CHANNELS */
+
 /*---------------------------------------------------------------------------*/
 void
 energest_init(void)
@@ -64,6 +83,14 @@ energest_init(void)
     energest_leveldevice_current_leveltime[i].current = 0;
   }
 #endif
+#if ENERGEST_CHANNELS
+  memset(channel_time, 0, sizeof(channel_time));
+  channel_mark[0] = channel_mark[1] = 0;
+  current_channel = 0;
+  channel_switches = channel_settle_time = 0;
+  channel_surveying = 0;
+  channel_survey_switches = 0;
+#endif /* ENERGEST_CHANNELS */
 }
 /*---------------------------------------------------------------------------*/
 unsigned long
@@ -113,9 +140,113 @@ energest_flush(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if ENERGEST_CHANNELS
+/* Charges the radio time since the last call to the current channel */
+static void
+channel_account(void)
+{
+  unsigned long transmit, listen;
+  int i;
+
+  transmit = energest_type_time(ENERGEST_TYPE_TRANSMIT);
+  listen = energest_type_time(ENERGEST_TYPE_LISTEN);
+  i = current_channel - ENERGEST_CHANNEL_FIRST;
+  if(i >= 0 && i < ENERGEST_CHANNEL_NUM) {
+    channel_time[i][ENERGEST_CHANNEL_TRANSMIT] += transmit - channel_mark[0];
+    channel_time[i][ENERGEST_CHANNEL_LISTEN] += listen - channel_mark[1];
+  }
+  channel_mark[0] = transmit;
+  channel_mark[1] = listen;
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_channel_switch(int channel, rtimer_clock_t settle)
+{
+  channel_account();
+  current_channel = channel;
+  if(channel_surveying) {
+    channel_survey_switches++;
+    return;
+  }
+  channel_switches++;
+  channel_settle_time += settle;
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_channel_survey(int on)
+{
+  channel_surveying = on;
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_channel_receive(int bytes)
+{
+  int i;
+
+  i = current_channel - ENERGEST_CHANNEL_FIRST;
+  if(i >= 0 && i < ENERGEST_CHANNEL_NUM) {
+    channel_time[i][ENERGEST_CHANNEL_RECEIVE] += bytes;
+  }
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+energest_channel_time(int type, int channel)
+{
+  unsigned long t;
+  int i;
+
+  i = channel - ENERGEST_CHANNEL_FIRST;
+  if(i < 0 || i >= ENERGEST_CHANNEL_NUM ||
+     type < 0 || type >= ENERGEST_CHANNEL_TYPE_MAX) {
+    return 0;
+  }
+  channel_account();
+  t = channel_time[i][type];
+  if(type == ENERGEST_CHANNEL_RECEIVE) {
+    /* Split so that the multiplication does not overflow */
+    t = (t / BYTES_PER_SECOND) * RTIMER_SECOND +
+      ((t % BYTES_PER_SECOND) * RTIMER_SECOND) / BYTES_PER_SECOND;
+  }
+  return t;
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+energest_channel_switches(void)
+{
+  return channel_switches;
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+energest_channel_settle_time(void)
+{
+  return channel_settle_time;
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+energest_channel_survey_switches(void)
+{
+  return channel_survey_switches;
+}
+#else /* ENERGEST_CHANNELS */
+void energest_channel_switch(int channel, rtimer_clock_t settle) {}
+void energest_channel_receive(int bytes) {}
+unsigned long energest_channel_time(int type, int channel) { return 0; }
+unsigned long energest_channel_switches(void) { return 0; }
+unsigned long energest_channel_settle_time(void) { return 0; }
+void energest_channel_survey(int on) {}
+unsigned long energest_channel_survey_switches(void) { return 0; }
+#endif /* ENERGEST_CHANNELS */
+/*---------------------------------------------------------------------------*/
 #else /* ENERGEST_CONF_ON */
 void energest_type_set(int type, unsigned long val) {}
 void energest_init(void) {}
 unsigned long energest_type_time(int type) { return 0; }
 void energest_flush(void) {}
+void energest_channel_switch(int channel, rtimer_clock_t settle) {}
+void energest_channel_receive(int bytes) {}
+unsigned long energest_channel_time(int type, int channel) { return 0; }
+unsigned long energest_channel_switches(void) { return 0; }
+unsigned long energest_channel_settle_time(void) { return 0; }
+void energest_channel_survey(int on) {}
+unsigned long energest_channel_survey_switches(void) { return 0; }
 #endif /* ENERGEST_CONF_ON */
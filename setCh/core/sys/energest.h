@@ -67,8 +67,37 @@ enum energest_type {
   ENERGEST_TYPE_MAX
 };
 
+/* Radio time per IEEE 802.15.4 channel, and the cost of switching
+   between them */
+#ifdef ENERGEST_CONF_CHANNELS
+#define ENERGEST_CHANNELS ENERGEST_CONF_CHANNELS
+#else
+#define ENERGEST_CHANNELS 0
+#endif
+
+#define ENERGEST_CHANNEL_FIRST 11
+#define ENERGEST_CHANNEL_NUM   16
+
+enum energest_channel_type {
+  ENERGEST_CHANNEL_TRANSMIT,
+  ENERGEST_CHANNEL_LISTEN,
+  /* Airtime of the frames received, part of the listen time */
+  ENERGEST_CHANNEL_RECEIVE,
+
+  ENERGEST_CHANNEL_TYPE_MAX
+};
+
 void energest_init(void);
 unsigned long energest_type_time(int type);
+/* Times are in rtimer ticks, like energest_type_time() */
+unsigned long energest_channel_time(int type, int channel);
+unsigned long energest_channel_switches(void);
+unsigned long energest_channel_settle_time(void);
+/* Retunes while the spectrum survey samples, not in the above */
+unsigned long energest_channel_survey_switches(void);
+void energest_channel_switch(int channel, rtimer_clock_t settle);
+void energest_channel_survey(int on);
+void energest_channel_receive(int bytes);
 #ifdef ENERGEST_CONF_LEVELDEVICE_LEVELS
 unsigned long energest_leveldevice_leveltime(int powerlevel);
 #endif
@@ -126,4 +155,18 @@ extern energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVI
 #define ENERGEST_OFF_LEVEL(type,level) do { } while(0)
 #endif /* ENERGEST_CONF_ON */
 
+#if ENERGEST_CONF_ON && ENERGEST_CHANNELS
+/* Called by the radio driver when it tunes to channel, settle being the
+   time the switch took, and for every frame received */
+#define ENERGEST_CHANNEL_SWITCH(channel, settle) \
+  energest_channel_switch(channel, settle)
+#define ENERGEST_CHANNEL_RECEIVE(bytes) energest_channel_receive(bytes)
+/* Brackets the retunes of a spectrum survey sample */
+#define ENERGEST_CHANNEL_SURVEY(on) energest_channel_survey(on)
+#else /* ENERGEST_CONF_ON && ENERGEST_CHANNELS */
+#define ENERGEST_CHANNEL_SWITCH(channel, settle) do { } while(0)
+#define ENERGEST_CHANNEL_RECEIVE(bytes) do { } while(0)
+#define ENERGEST_CHANNEL_SURVEY(on) do { } while(0)
+#endif /* ENERGEST_CONF_ON && ENERGEST_CHANNELS */
+
 #endif /* __ENERGEST_H__ */
@@ -68,8 +68,21 @@ struct event_data {
 static process_num_events_t nevents, fevent;
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
 
+#if PROCESS_CONF_PRIORITY
+/* Events for high priority processes, delivered before the others */
+static process_num_events_t nevents_high, fevent_high;
+static struct event_data events_high[PROCESS_CONF_NUMEVENTS_HIGH];
+#define NEVENTS() (nevents + nevents_high)
+#else
+#define NEVENTS() nevents
+#endif
+
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
+#if PROCESS_CONF_PRIORITY
+process_num_events_t process_maxevents_high;
+#endif
+unsigned short process_dropped;
 #endif
 
 static volatile unsigned char poll_requested;
@@ -185,6 +198,9 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
   if((p->state & PROCESS_STATE_RUNNING) &&
      p->thread != NULL) {
     PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
+#if PROCESS_CONF_STATS
+    p->nevents++;
+#endif
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
     ret = p->thread(&p->pt, ev, data);
@@ -210,8 +226,15 @@ process_init(void)
   lastevent = PROCESS_EVENT_MAX;
 
   nevents = fevent = 0;
+#if PROCESS_CONF_PRIORITY
+  nevents_high = fevent_high = 0;
+#endif /* PROCESS_CONF_PRIORITY */
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
+#if PROCESS_CONF_PRIORITY
+  process_maxevents_high = 0;
+#endif /* PROCESS_CONF_PRIORITY */
+  process_dropped = 0;
 #endif /* PROCESS_CONF_STATS */
 
   process_current = process_list = NULL;
@@ -227,6 +250,16 @@ do_poll(void)
   struct process *p;
 
   poll_requested = 0;
+#if PROCESS_CONF_PRIORITY
+  /* Call the high priority processes that need to be polled first. */
+  for(p = process_list; p != NULL; p = p->next) {
+    if(p->needspoll && p->priority == PROCESS_PRIORITY_HIGH) {
+      p->state = PROCESS_STATE_RUNNING;
+      p->needspoll = 0;
+      call_process(p, PROCESS_EVENT_POLL, NULL);
+    }
+  }
+#endif /* PROCESS_CONF_PRIORITY */
   /* Call the processes that needs to be polled. */
   for(p = process_list; p != NULL; p = p->next) {
     if(p->needspoll) {
@@ -258,6 +291,19 @@ do_event(void)
    * call the poll handlers inbetween.
    */
 
+#if PROCESS_CONF_PRIORITY
+  if(nevents_high > 0) {
+
+    /* Events for high priority processes go first. */
+    ev = events_high[fevent_high].ev;
+
+    data = events_high[fevent_high].data;
+    receiver = events_high[fevent_high].p;
+
+    fevent_high = (fevent_high + 1) % PROCESS_CONF_NUMEVENTS_HIGH;
+    --nevents_high;
+  } else
+#endif /* PROCESS_CONF_PRIORITY */
   if(nevents > 0) {
     
     /* There are events that we should deliver. */
@@ -270,31 +316,33 @@ do_event(void)
        and decrese the number of events. */
     fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
     --nevents;
+  } else {
+    return;
+  }
 
-    /* If this is a broadcast event, we deliver it to all events, in
-       order of their priority. */
-    if(receiver == PROCESS_BROADCAST) {
-      for(p = process_list; p != NULL; p = p->next) {
-
-	/* If we have been requested to poll a process, we do this in
-	   between processing the broadcast event. */
-	if(poll_requested) {
-	  do_poll();
-	}
-	call_process(p, ev, data);
-      }
-    } else {
-      /* This is not a broadcast event, so we deliver it to the
-	 specified process. */
-      /* If the event was an INIT event, we should also update the
-	 state of the process. */
-      if(ev == PROCESS_EVENT_INIT) {
-	receiver->state = PROCESS_STATE_RUNNING;
-      }
+  /* If this is a broadcast event, we deliver it to all events, in
+     order of their priority. */
+  if(receiver == PROCESS_BROADCAST) {
+    for(p = process_list; p != NULL; p = p->next) {
 
-      /* Make sure that the process actually is running. */
-      call_process(receiver, ev, data);
+      /* If we have been requested to poll a process, we do this in
+         between processing the broadcast event. */
+      if(poll_requested) {
+        do_poll();
+      }
+      call_process(p, ev, data);
+    }
+  } else {
+    /* This is not a broadcast event, so we deliver it to the
+       specified process. */
+    /* If the event was an INIT event, we should also update the
+       state of the process. */
+    if(ev == PROCESS_EVENT_INIT) {
+      receiver->state = PROCESS_STATE_RUNNING;
     }
+
+    /* Make sure that the process actually is running. */
+    call_process(receiver, ev, data);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -309,13 +357,13 @@ process_run(void)
   /* Process one event from the queue */
   do_event();
 
-  return nevents + poll_requested;
+  return NEVENTS() + poll_requested;
 }
 /*---------------------------------------------------------------------------*/
 int
 process_nevents(void)
 {
-  return nevents + poll_requested;
+  return NEVENTS() + poll_requested;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -331,7 +379,29 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   PROCESS_NAME_STRING(PROCESS_CURRENT()), ev,
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
-  
+
+#if PROCESS_CONF_PRIORITY
+  if(p != PROCESS_BROADCAST && p->priority == PROCESS_PRIORITY_HIGH &&
+     nevents_high < PROCESS_CONF_NUMEVENTS_HIGH) {
+    snum = (process_num_events_t)(fevent_high + nevents_high) %
+      PROCESS_CONF_NUMEVENTS_HIGH;
+    events_high[snum].ev = ev;
+    events_high[snum].data = data;
+    events_high[snum].p = p;
+    ++nevents_high;
+
+#if PROCESS_CONF_STATS
+    if(nevents_high > process_maxevents_high) {
+      process_maxevents_high = nevents_high;
+    }
+#endif /* PROCESS_CONF_STATS */
+
+    return PROCESS_ERR_OK;
+  }
+  /* When their queue is full, events for high priority processes
+     share the normal queue. */
+#endif /* PROCESS_CONF_PRIORITY */
+
   if(nevents == PROCESS_CONF_NUMEVENTS) {
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
@@ -340,6 +410,12 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
       printf("soft panic: event queue is full when event %d was posted to %s frpm %s\n", ev, PROCESS_NAME_STRING(p), PROCESS_NAME_STRING(process_current));
     }
 #endif /* DEBUG */
+#if PROCESS_CONF_STATS
+    process_dropped++;
+    if(p != PROCESS_BROADCAST) {
+      p->ndropped++;
+    }
+#endif /* PROCESS_CONF_STATS */
     return PROCESS_ERR_FULL;
   }
   
@@ -385,4 +461,12 @@ process_is_running(struct process *p)
   return p->state != PROCESS_STATE_NONE;
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_PRIORITY
+void
+process_set_priority(struct process *p, unsigned char priority)
+{
+  p->priority = priority;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* PROCESS_CONF_PRIORITY */
 /** @} */
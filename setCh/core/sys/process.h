@@ -88,6 +88,31 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/*
+ * With PROCESS_CONF_PRIORITY, events posted to processes marked with
+ * process_set_priority() go to a queue of their own that is emptied
+ * before the normal event queue, and such processes are polled before
+ * the others. The netstack marks its processes, so that bursts of
+ * application events do not delay or drop MAC and routing events.
+ */
+#ifndef PROCESS_CONF_PRIORITY
+#define PROCESS_CONF_PRIORITY 0
+#endif /* PROCESS_CONF_PRIORITY */
+
+/*
+ * When the high priority queue is full, further events for high
+ * priority processes spill into the normal queue. Such an event may
+ * then be delivered after a later one that found room in the high
+ * priority queue, so a high priority process must not rely on the
+ * order of its events under load.
+ */
+#ifndef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_CONF_NUMEVENTS_HIGH 8
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
+#define PROCESS_PRIORITY_NORMAL 0
+#define PROCESS_PRIORITY_HIGH   1
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -323,6 +348,14 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_CONF_PRIORITY
+  unsigned char priority;
+#endif
+#if PROCESS_CONF_STATS
+  /* Events delivered to the process, and events posted to it that were
+     dropped because the event queue was full */
+  unsigned short nevents, ndropped;
+#endif
 };
 
 /**
@@ -519,6 +552,33 @@ CCIF int process_is_running(struct process *p);
  */
 int process_nevents(void);
 
+/**
+ * Set the scheduling priority of a process.
+ *
+ * Events posted to a process with PROCESS_PRIORITY_HIGH are delivered
+ * before any event posted to a process with PROCESS_PRIORITY_NORMAL,
+ * and it is polled first. Without PROCESS_CONF_PRIORITY this does
+ * nothing.
+ *
+ * \param p A pointer to the process' process structure.
+ * \param priority PROCESS_PRIORITY_HIGH or PROCESS_PRIORITY_NORMAL.
+ */
+#if PROCESS_CONF_PRIORITY
+void process_set_priority(struct process *p, unsigned char priority);
+#else
+#define process_set_priority(p, priority)
+#endif
+
+#if PROCESS_CONF_STATS
+/* High-water marks of the event queues, and the number of events
+   dropped because a queue was full */
+extern process_num_events_t process_maxevents;
+#if PROCESS_CONF_PRIORITY
+extern process_num_events_t process_maxevents_high;
+#endif
+extern unsigned short process_dropped;
+#endif /* PROCESS_CONF_STATS */
+
 /** @} */
 
 CCIF extern struct process *process_list;
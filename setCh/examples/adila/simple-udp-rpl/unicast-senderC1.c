@@ -42,6 +42,7 @@
 
 #include "simple-udp.h"
 #include "servreg-hack.h"
+#include "powertrace.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -50,6 +51,11 @@
 #include "lib/memb.h"
 
 #include "net/retx-table.h"
+#include "net/channel-estimator.h"
+#include "net/channel-msg.h"
+#include "net/channel-switch.h"
+#include "net/mac/spectrum-survey.h"
+#include "net/mac/radio-channel.h"
 
 #define UDP_PORT 1234
 #define SERVICE_ID 190
@@ -65,6 +71,22 @@
 //#define SEND_INTERVAL		(2000 * CLOCK_SECOND)
 //#define SEND_TIME		(random_rand() % (SEND_INTERVAL))
 #define SEND_TIME		(random_rand() % (60 * CLOCK_SECOND))
+
+//NBRPROBE messages sent to a neighbour on the new channel
+#define NBR_PROBES		8
+
+//the spectrum survey goes to the LPBR this often, so that it has one
+//for every node before it assigns channels
+#ifndef SURVEY_INTERVAL
+#define SURVEY_INTERVAL		(300 * CLOCK_SECOND)
+#endif
+
+//ask the LPBR for another channel when a link keeps losing frames,
+//0 for the single-channel baseline
+#ifndef SEND_CH_REQUEST
+#define SEND_CH_REQUEST		1
+#endif
+
 //#define SEND_TIME		(20 * CLOCK_SECOND)
 
 struct probeResult {
@@ -105,9 +127,6 @@ uint8_t keepType;
 //extern uint8_t keepListNo = 0;
 //extern uint8_t nbrNo = 0;
 
-uint8_t sum;
-uint8_t divide;
-
 //uip_ipaddr_t toParent;
   uip_ipaddr_t sendTo1;
 
@@ -118,23 +137,12 @@ static struct simple_udp_connection unicast_connection;
 //the application specific event value
 static process_event_t event_data_ready;
 
-enum {
-	CH_CHANGE,
-	NBR_CH_CHANGE,
-	STARTPROBE,
-	NBRPROBE,
-	PROBERESULT,
-	CONFIRM_CH,
-	GET_ACK,
-SENTRECV,
-SEND_NBR
-};
-
 struct unicast_message {
 	uint8_t type;
 	uint8_t value;
 	//uint8_t holdV;
 	uint8_t value2;
+	uint16_t time;
 
 	uip_ipaddr_t address;
 	uip_ipaddr_t *addrPtr; 
@@ -145,24 +153,124 @@ struct unicast_message {
 /*---------------------------------------------------------------------------*/
 PROCESS(unicast_sender_process, "Unicast sender example process");
 PROCESS(test1, "test");
-AUTOSTART_PROCESSES(&unicast_sender_process, &test1);
+PROCESS(retx_process, "Retransmission watch");
+PROCESS(switch_process, "Scheduled channel switch");
+AUTOSTART_PROCESSES(&unicast_sender_process, &test1, &retx_process,
+                    &switch_process);
+/*---------------------------------------------------------------------------*/
+/* The neighbour is found from the interface identifier of its
+   address, so the whole link-layer address has to match */
+static void ipToLladdr(const uip_ipaddr_t *addr, uip_lladdr_t *lladdr) {
+  memcpy(lladdr, &addr->u8[8], UIP_LLADDR_LEN);
+  lladdr->addr[0] ^= 0x02;
+}
+/*---------------------------------------------------------------------------*/
+/* Control messages go on air in the compact encoding of channel-msg,
+   the pointer and unset fields stay on the node */
+static void sendEncoded(const struct channel_msg *out, const uip_ipaddr_t *to) {
+  uint8_t buf[CHANNEL_MSG_MAX_LEN];
+  int len;
+
+  len = channel_msg_encode(buf, sizeof(buf), out);
+  if(len > 0) {
+    simple_udp_sendto(&unicast_connection, buf, len, to);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void sendMsg(const struct unicast_message *msg, const uip_ipaddr_t *to) {
+  struct channel_msg out;
+
+  out.type = msg->type;
+  out.value = msg->value;
+  out.value2 = msg->value2;
+  out.time = msg->time;
+  uip_ipaddr_copy(&out.address, &msg->address);
+  out.survey_len = 0;
+
+  sendEncoded(&out, to);
+}
 /*---------------------------------------------------------------------------*/
 static void updateNbrTable(uip_ipaddr_t *addr, uint8_t msgValue) {
-  //static uip_ds6_route_t *r;
-  //uip_ipaddr_t nextHopIP;
+  uip_lladdr_t lladdr;
 
-  static uip_ds6_nbr_t *nbr;
+  ipToLladdr(addr, &lladdr);
+  uip_ds6_nbr_set_channel(uip_ds6_nbr_ll_lookup(&lladdr), msgValue);
+  //the old channel's retransmissions say nothing about the new one
+  retx_table_clear((rimeaddr_t *)&lladdr);
+}
+/*---------------------------------------------------------------------------*/
+static void sendConfirm(uint8_t theChannel) {
+  struct unicast_message msg2;
+  uip_ipaddr_t lpbrAddr;
+
+  uip_ip6addr(&lpbrAddr, 0xaaaa, 0, 0, 0, 0x212, 0x7401, 0x0001, 0x0101);
+
+  msg2.type = CONFIRM_CH;
+  msg2.value = theChannel;
+  msg2.value2 = 0;
+  memset(&msg2.address, 0, sizeof(msg2.address));
+
+  sendMsg(&msg2, &lpbrAddr);
+}
+/*---------------------------------------------------------------------------*/
+#if CONTIKIMAC_CONF_SPECTRUM_SURVEY
+static struct ctimer survey_timer;
+
+//send the background survey of all 16 channels to the LPBR
+static void sendSurvey(void *ptr) {
+  struct channel_msg out;
+  uip_ipaddr_t lpbrAddr;
 
-  for(nbr = nbr_table_head(ds6_neighbors); nbr != NULL;
-    nbr = nbr_table_next(ds6_neighbors,nbr)) {
-    if(addr->u8[13] == nbr->ipaddr.u8[13]) {
-      nbr->nbrCh = msgValue;
-      //printf("UPDATE NBR TABLE ");
-      //uip_debug_ipaddr_print(&nbr->ipaddr);
-      //printf(" update nbr->nbrCh %d ", nbr->nbrCh);
-      //printf("\n\n");
+  uip_ip6addr(&lpbrAddr, 0xaaaa, 0, 0, 0, 0x212, 0x7401, 0x0001, 0x0101);
+
+  memset(&out, 0, sizeof(out));
+  out.type = SURVEY;
+  spectrum_survey_pack(out.survey);
+  out.survey_len = SPECTRUM_SURVEY_REPORT_LEN;
+  sendEncoded(&out, &lpbrAddr);
+
+  ctimer_set(&survey_timer, SURVEY_INTERVAL, sendSurvey, NULL);
+}
+#endif
+/*---------------------------------------------------------------------------*/
+//NBR_CH_SCHEDULE or CH_ABORT goes to one neighbour at a time from a
+//ctimer, so that switch_process keeps receiving the switch events
+static struct ctimer fanoutTimer;
+static uip_ds6_nbr_t *fanoutNbr;
+static uint8_t fanoutType;
+static uint8_t fanoutCh;
+
+static void fanout(void *ptr) {
+  struct unicast_message msg2;
+
+  if(fanoutNbr == NULL) {
+    return;
+  }
+  memset(&msg2, 0, sizeof(msg2));
+  msg2.type = fanoutType;
+  msg2.value = fanoutCh;
+  if(fanoutType == NBR_CH_SCHEDULE) {
+    msg2.time = CHANNEL_SWITCH_MS(channel_switch_remaining());
+    if(msg2.time == 0) {
+      fanoutNbr = NULL;
+      return;
     }
   }
+  sendMsg(&msg2, &fanoutNbr->ipaddr);
+
+  fanoutNbr = nbr_table_next(ds6_neighbors, fanoutNbr);
+  if(fanoutNbr != NULL) {
+    ctimer_set(&fanoutTimer, CHANNEL_SWITCH_NBR_SPACING, fanout, NULL);
+  }
+}
+
+//an abort replaces a schedule fan-out that is still running
+static void startFanout(uint8_t type, uint8_t theChannel) {
+  ctimer_stop(&fanoutTimer);
+  fanoutType = type;
+  fanoutCh = theChannel;
+  fanoutNbr = nbr_table_head(ds6_neighbors);
+  fanout(NULL);
 }
 /*---------------------------------------------------------------------------*/
 static void removeProbe() {
@@ -220,9 +328,6 @@ static void checkAckProbeResultTable(uint8_t theChannel) {
   }
 
   if(confirmToLPBR == 0) {
-    msg2.type = CONFIRM_CH;
-    msg2.value = theChannel;
-    msg2.addrPtr = &sendTo1;
 //    msg2.paddingBuf[30] = " ";
 
 printf("S confirm\n");
@@ -230,17 +335,31 @@ printf("S confirm\n");
 //    uip_debug_ipaddr_print(msg2.addrPtr);
 //    printf(" channel %d\n", msg2.value);
 
-    simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2), msg2.addrPtr);
+    sendConfirm(theChannel);
     removeProbe();
   }
 }
 /*---------------------------------------------------------------------------*/
-//static void readProbeResult() {
-static void readProbeResult(uint8_t a, uint8_t b) {
+/* Without the link estimator, the new channel is kept only if every
+   probe from every neighbour got through */
+static int newChannelUsable(uint8_t channel) {
+#if CHANNEL_ESTIMATOR_ENABLED
+  return channel_estimator_usable(channel);
+#else /* CHANNEL_ESTIMATOR_ENABLED */
+  struct probeResult *pr;
+
+  for(pr = list_head(probeResult_table); pr != NULL; pr = pr->next) {
+    if(pr->chNum != 0 && pr->rxValue < NBR_PROBES) {
+      return 0;
+    }
+  }
+  return 1;
+#endif /* CHANNEL_ESTIMATOR_ENABLED */
+}
+/*---------------------------------------------------------------------------*/
+static void readProbeResult() {
   struct probeResult *pr;
   struct unicast_message msg2;
-  sum = 0;
-  divide = 0;
 
   //uip_ipaddr_t sendTo1;
   uip_ip6addr(&sendTo1, 0xaaaa, 0, 0, 0, 0x212, 0x7401, 0x0001, 0x0101);
@@ -267,7 +386,7 @@ static void readProbeResult(uint8_t a, uint8_t b) {
     msg2.value2 = pr->rxValue; 
 
     //! Sending PROBERESULT to LPBR without deciding the change yet
-    simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2) + 1, &sendTo1);
+    sendMsg(&msg2, &sendTo1);
     //process_post_synch(&test1, event_data_ready, &msg2);
     */
 /*    sum = sum + pr->rxValue;
@@ -286,7 +405,8 @@ printf("AFTER 1 PROBERESULT\n");
 
   //if((sum/divide) >= ((sum/divide)/2)) {
   //if((sum/divide) == 8) {
-  if((a/b) == 8) {
+  //keep the new channel if the probes from the neighbours got through
+  if(newChannelUsable(uip_ds6_if.addr_list[1].currentCh)) {
     msg2.value = uip_ds6_if.addr_list[1].currentCh;
   }
   else {
@@ -294,7 +414,7 @@ printf("AFTER 1 PROBERESULT\n");
 
 //reset here?
 uip_ds6_if.addr_list[1].currentCh = uip_ds6_if.addr_list[1].prevCh;
-cc2420_set_channel(uip_ds6_if.addr_list[1].currentCh);
+radio_channel_set(uip_ds6_if.addr_list[1].currentCh);
   }
 
 //20may
@@ -387,7 +507,7 @@ static void keepSentRecv(const uip_ipaddr_t *sendToAddr, uint8_t pktSent, uint8_
 	  //msg2.value2 = pr->rxValue; 
 
 	  printf("Sending LPBR has sent 2 packets\n");
-	  simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2) + 1, &sendTo1);
+	  sendMsg(&msg2, &sendTo1);
 
           sr->noSent = 0;
 
@@ -410,7 +530,7 @@ static void keepSentRecv(const uip_ipaddr_t *sendToAddr, uint8_t pktSent, uint8_
 	  //msg2.value2 = pr->rxValue; 
 
 	  printf("Sending LPBR has sent 2 packets\n");
-	  simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2) + 1, &sendTo1);
+	  sendMsg(&msg2, &sendTo1);
 	  //return;*/
       /*  }
 	return;
@@ -436,9 +556,13 @@ receiver(struct simple_udp_connection *c,
          const uint8_t *data,
          uint16_t datalen)
 {
-  struct unicast_message *msg;
+  struct channel_msg in;
+  const struct channel_msg *msg;
   struct unicast_message msg2;
-  msg = data;
+
+  //anything that is not a control message falls through to the data case
+  channel_msg_decode(&in, data, datalen);
+  msg = &in;
 
   struct probeResult *pr;
 
@@ -466,6 +590,48 @@ receiver(struct simple_udp_connection *c,
     process_post_synch(&test1, event_data_ready, &msg2);
   }//end if(msg->type == CH_CHANGE)
 
+  else if(msg->type == CH_SCHEDULE) {
+    printf("%d: %d received CH_SCHEDULE in %u ms from ", cc2420_get_channel(),
+           msg->value, msg->time);
+    uip_debug_ipaddr_print(sender_addr);
+    printf("\n");
+
+    msg2.type = CH_SCHEDULE;
+    msg2.value = msg->value;
+    msg2.time = msg->time;
+
+    process_post_synch(&switch_process, event_data_ready, &msg2);
+  }
+
+  else if(msg->type == NBR_CH_SCHEDULE) {
+    //our entry for the sender moves when the sender does; if it
+    //cannot, the sender must not count on us
+    if(channel_switch_nbr(sender_addr, msg->value,
+                          CHANNEL_SWITCH_TICKS(msg->time))) {
+      msg2.type = SCHEDULE_ACK;
+    }
+    else {
+      msg2.type = SCHEDULE_NACK;
+    }
+    msg2.value = msg->value;
+    sendMsg(&msg2, sender_addr);
+  }
+
+  else if(msg->type == SCHEDULE_ACK) {
+    channel_switch_ack(sender_addr, msg->value);
+  }
+
+  else if(msg->type == SCHEDULE_NACK) {
+    printf("S nack for %d from ", msg->value);
+    uip_debug_ipaddr_print(sender_addr);
+    printf("\n");
+    channel_switch_nack(msg->value);
+  }
+
+  else if(msg->type == CH_ABORT) {
+    channel_switch_nbr_cancel(sender_addr);
+  }
+
   else if(msg->type == NBR_CH_CHANGE) {
     printf("%d: %d received NBR_CH_CHANGE from ", cc2420_get_channel(), msg->value);
     uip_debug_ipaddr_print(sender_addr);
@@ -564,7 +730,7 @@ printf("\n\n");
       //uip_debug_ipaddr_print(msg2.addrPtr);
       //printf(" channel %d\n", msg2.value);
 
-      simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2), msg2.addrPtr);
+      sendMsg(&msg2, msg2.addrPtr);
     }*/
   }
 
@@ -635,6 +801,9 @@ PROCESS_THREAD(unicast_sender_process, ev, data)
   simple_udp_register(&unicast_connection, UDP_PORT,
                       NULL, UDP_PORT, receiver);
 
+  //what the channel changes cost, per channel
+  powertrace_start(CLOCK_SECOND * 60);
+
 cc2420_set_txpower(11);
 
     etimer_set(&send_timer, 60 * CLOCK_SECOND);
@@ -657,9 +826,15 @@ noOfNbr++;
       //printf(" channel %d\n", nbr->nbrCh);
 */
 //simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2), addr);
-simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2), &sendTo1);
+sendMsg(&msg2, &sendTo1);
     }
 
+#if CONTIKIMAC_CONF_SPECTRUM_SURVEY
+  //spread the first surveys of the nodes over ten seconds
+  ctimer_set(&survey_timer, random_rand() % (10 * CLOCK_SECOND),
+             sendSurvey, NULL);
+#endif
+
 //printf("NO %d\n\n", noOfNbr);
 
   etimer_set(&periodic_timer, SEND_INTERVAL);
@@ -734,6 +909,9 @@ PROCESS_THREAD(test1, ev, data)
   //uip_ipaddr_t toParent;
 
   static uip_ds6_nbr_t *nbr;
+#if CHANNEL_ESTIMATOR_ENABLED
+  uip_lladdr_t lladdr;
+#endif /* CHANNEL_ESTIMATOR_ENABLED */
 
 uint8_t ww = 0;
 uint8_t delayTime = 0;
@@ -824,7 +1002,7 @@ printf("START\n\n");
 
             uip_debug_ipaddr_print(msg2.addrPtr);
             printf("\n");
-	    simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2), msg2.addrPtr);	
+	    sendMsg(&msg2, msg2.addrPtr);	
 
 	    etimer_set(&time, delayTime * CLOCK_SECOND);
 	    //etimer_set(&time, 1 * CLOCK_SECOND);
@@ -852,13 +1030,16 @@ printf("START\n\n");
     msg2.value2 = pr->rxValue; 
 
     //! Sending PROBERESULT to LPBR without deciding the change yet
-    simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2) + 1, &sendTo1G);
+    sendMsg(&msg2, &sendTo1G);
     //etimer_set(&time, 1 * CLOCK_SECOND);
     //PROCESS_YIELD_UNTIL(etimer_expired(&time));
     //process_post_synch(&test1, event_data_ready, &msg2);
 
-    sum = sum + pr->rxValue;
-    divide++;
+#if CHANNEL_ESTIMATOR_ENABLED
+    ipToLladdr(&pr->pAddr, &lladdr);
+    channel_estimator_probe((rimeaddr_t *)&lladdr, pr->chNum, pr->rxValue,
+                            NBR_PROBES);
+#endif /* CHANNEL_ESTIMATOR_ENABLED */
    }
    //nbrNo++;
   }
@@ -866,7 +1047,7 @@ printf("START\n\n");
     etimer_set(&time, 1 * CLOCK_SECOND);
     PROCESS_YIELD_UNTIL(etimer_expired(&time));
 
-        readProbeResult(sum, divide);
+        readProbeResult();
       }
 
     }
@@ -888,7 +1069,7 @@ printf("START\n\n");
       y = 1;
       //! for padding as shortest packet size is 43 bytes (defined in contikimac.c)
       //msg2.paddingBuf[30] = " ";
-      for(x = 1; x <= 8; x++) {
+      for(x = 1; x <= NBR_PROBES; x++) {
 //      for(x = 1; x <= 1; x++) {
       //for(x = 1; x <= 10; x++) {
       msg2.type = NBRPROBE;
@@ -905,7 +1086,7 @@ printf("START\n\n");
 	printf("\n");
 
 	y++;
-	simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2), msg2.addrPtr);
+	sendMsg(&msg2, msg2.addrPtr);
 
       etimer_set(&time, 1 * CLOCK_SECOND);
       PROCESS_YIELD_UNTIL(etimer_expired(&time));
@@ -950,7 +1131,7 @@ printf("S confirm ch\n");
 //	printf("%d Sending CONFIRM CH to all neighbours ", nbr->nbrCh);
 //        uip_debug_ipaddr_print(msg2.addrPtr);
 //        printf("\n");
-	simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2), msg2.addrPtr);	
+	sendMsg(&msg2, msg2.addrPtr);	
 
 	etimer_set(&time, 0.7 * CLOCK_SECOND);
 	PROCESS_YIELD_UNTIL(etimer_expired(&time));
@@ -999,10 +1180,113 @@ printf("S get ack\n");
 
       //@
       //cc2420_set_channel(changeTo);
-      simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2), msg2.addrPtr);
+      sendMsg(&msg2, msg2.addrPtr);
     }
   }//end while(1)
 
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+PROCESS_THREAD(retx_process, ev, data)
+{
+#if SEND_CH_REQUEST
+  static uip_ds6_nbr_t *nbr;
+  struct unicast_message msg2;
+  uip_ipaddr_t lpbrAddr;
+#endif
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == retx_table_event);
+
+#if SEND_CH_REQUEST
+    //ask the LPBR to move the neighbour whose link went bad, once we
+    //know which channel the link is on
+    nbr = uip_ds6_nbr_ll_lookup((uip_lladdr_t *)data);
+    if(nbr != NULL && nbr->nbrCh != 0) {
+      uip_ip6addr(&lpbrAddr, 0xaaaa, 0, 0, 0, 0x212, 0x7401, 0x0001, 0x0101);
+
+      msg2.type = CH_REQUEST;
+      msg2.value = nbr->nbrCh;
+      msg2.value2 = retx_table_ack_ratio((rimeaddr_t *)data);
+      msg2.address = nbr->ipaddr;
+
+      printf("S ch request %d for ", msg2.value);
+      uip_debug_ipaddr_print(&msg2.address);
+      printf("\n");
+      sendMsg(&msg2, &lpbrAddr);
+    }
+#endif
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+/* Runs a channel switch scheduled by the LPBR: every neighbour gets the
+   new channel and the time left until it activates, and acks it. The
+   switch itself happens in channel-switch, which tells us the outcome. */
+PROCESS_THREAD(switch_process, ev, data)
+{
+  static uip_ds6_nbr_t *nbr;
+  static uint8_t theChannel;
+  struct unicast_message *msg;
+  struct unicast_message msg2;
+  const struct channel_switch_info *info;
+  uip_ipaddr_t lpbrAddr;
+  uip_lladdr_t lladdr;
+  uint8_t n;
+
+  PROCESS_BEGIN();
+
+  channel_switch_init(&switch_process);
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == event_data_ready ||
+                             ev == channel_switch_event);
+
+    if(ev == event_data_ready) {
+      msg = data;
+      n = 0;
+      for(nbr = nbr_table_head(ds6_neighbors); nbr != NULL;
+        nbr = nbr_table_next(ds6_neighbors, nbr)) {
+        n++;
+      }
+      if(!channel_switch_start(msg->value, CHANNEL_SWITCH_TICKS(msg->time), n)) {
+        printf("CH_SCHEDULE %d ignored, a switch is pending\n", msg->value);
+        continue;
+      }
+      theChannel = msg->value;
+      startFanout(NBR_CH_SCHEDULE, theChannel);
+    }
+    else {
+      info = data;
+      theChannel = info->channel;
+      if(info->result == CHANNEL_SWITCH_COMMITTED) {
+        uip_ds6_if.addr_list[1].prevCh = uip_ds6_if.addr_list[1].currentCh;
+        uip_ds6_if.addr_list[1].currentCh = theChannel;
+        radio_channel_set(theChannel);
+        printf("S switched to %d\n", theChannel);
+        sendConfirm(theChannel);
+      }
+      else if(info->result == CHANNEL_SWITCH_NBR_SWITCHED) {
+        //the old channel's retransmissions say nothing about the new one
+        ipToLladdr(&info->addr, &lladdr);
+        retx_table_clear((rimeaddr_t *)&lladdr);
+      }
+      else {
+        //too few neighbours acked: they and the LPBR must forget it
+        printf("S rollback of %d\n", theChannel);
+        memset(&msg2, 0, sizeof(msg2));
+        msg2.type = CH_ABORT;
+        msg2.value = theChannel;
+        uip_ip6addr(&lpbrAddr, 0xaaaa, 0, 0, 0, 0x212, 0x7401, 0x0001, 0x0101);
+        sendMsg(&msg2, &lpbrAddr);
+        startFanout(CH_ABORT, theChannel);
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,265 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2015, Swedish Institute of Computer Science.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+# 3. Neither the name of the Institute nor the names of its contributors
+#    may be used to endorse or promote products derived from this software
+#    without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+# OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+# HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+# OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+# SUCH DAMAGE.
+
+"""Turns the logs of a benchmark run into JSON.
+
+  benchmark-report.py RUN
+      Reads RUN.testlog (mote output, from Cooja) and RUN.lpbrlog (border
+      router output, prefixed with the wall clock in ms) and prints the
+      PDR per window, the end-to-end latency percentiles, the duty cycle
+      and the channel switches of the run, with those saved by CSMA
+      channel grouping. Retunes of the spectrum survey are reported on
+      their own and are not channel switches. The MAC counters of the
+      PM lines are summed over the nodes.
+
+  benchmark-report.py --compare RUN.json...
+      Averages the runs over their seeds and compares every multichannel
+      result with the single-channel baseline at the same interference
+      level.
+"""
+
+import json
+import re
+import sys
+
+PDR_WINDOW = 300  # seconds, as in the hand-collected results
+
+SYNC = re.compile(r'^SYNC (\d+) (\d+)')
+MOTE = re.compile(r'^(\d+)\t(\d+)\t(.*)$')
+SENT = re.compile(r'Sending unicast (\d+) to')
+RECEIVED = re.compile(r"^(\d+) Data received from (\S+) on port .*'Message (\d+)'")
+POWER = re.compile(r'\bP \d+\.\d+ \d+ (\d+) (\d+) (\d+) (\d+)')
+SWITCHES = re.compile(r'\bPS \d+\.\d+ \d+ (\d+) (\d+)(?: (\d+))?(?: (\d+))?')
+MAC = re.compile(r'\bPM \d+\.\d+ \d+((?: \d+){10})$')
+MAC_FIELDS = ['broadcasts_replicated', 'broadcasts_rendezvous',
+              'broadcast_copies', 'broadcast_airtime',
+              'phase_hits', 'phase_misses', 'phase_channel_changes',
+              'phase_drops', 'retune_requests', 'retunes_skipped']
+
+
+def node_address(node):
+    """Global address of a Sky mote in Cooja, as the border router prints it."""
+    return 'aaaa::212:74%02x:%x:%x%02x' % (node, node, node, node)
+
+
+def percentile(values, p):
+    if not values:
+        return None
+    values = sorted(values)
+    k = (len(values) - 1) * p / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(values) - 1)
+    return values[lo] + (values[hi] - values[lo]) * (k - lo)
+
+
+def parse_run(run):
+    syncs = []
+    sent = {}
+    power = {}
+    switches = {}
+    avoided = {}
+    survey = {}
+    mac = {}
+    with open(run + '.testlog') as f:
+        for line in f:
+            line = line.rstrip('\n')
+            m = SYNC.match(line)
+            if m:
+                syncs.append((int(m.group(1)), int(m.group(2))))
+                continue
+            m = MOTE.match(line)
+            if not m:
+                continue
+            ms, node, text = int(m.group(1)), int(m.group(2)), m.group(3)
+            s = SENT.search(text)
+            if s:
+                sent.setdefault((node, int(s.group(1))), ms)
+                continue
+            s = POWER.search(text)
+            if s:
+                power[node] = [int(v) for v in s.groups()]
+                continue
+            s = SWITCHES.search(text)
+            if s:
+                switches[node] = int(s.group(1))
+                if s.group(3) is not None:
+                    avoided[node] = int(s.group(3))
+                if s.group(4) is not None:
+                    survey[node] = int(s.group(4))
+                continue
+            s = MAC.search(text)
+            if s:
+                mac[node] = [int(v) for v in s.group(1).split()]
+
+    nodes = {}
+    for node, _ in sent:
+        nodes[node_address(node)] = node
+
+    received = {}
+    try:
+        with open(run + '.lpbrlog') as f:
+            for line in f:
+                m = RECEIVED.match(line)
+                if not m or m.group(2) not in nodes:
+                    continue
+                key = (nodes[m.group(2)], int(m.group(3)))
+                received.setdefault(key, int(m.group(1)))
+    except IOError:
+        pass
+
+    return syncs, sent, received, power, switches, avoided, survey, mac
+
+
+def to_wall(syncs, ms):
+    """Maps simulation time onto the wall clock with the latest SYNC."""
+    base = None
+    for sim, wall in syncs:
+        if sim > ms:
+            break
+        base = (sim, wall)
+    if base is None:
+        return None
+    return base[1] + (ms - base[0])
+
+
+def report(run):
+    syncs, sent, received, power, switches, avoided, survey, mac = \
+        parse_run(run)
+
+    windows = {}
+    latencies = []
+    for key, ms in sent.items():
+        w = windows.setdefault(ms // 1000 // PDR_WINDOW, [0, 0])
+        w[0] += 1
+        if key in received:
+            w[1] += 1
+            wall = to_wall(syncs, ms)
+            if wall is not None and received[key] >= wall:
+                latencies.append(received[key] - wall)
+
+    pdr_over_time = []
+    for w in sorted(windows):
+        s, r = windows[w]
+        pdr_over_time.append({'time': w * PDR_WINDOW, 'sent': s,
+                              'received': r, 'pdr': 100.0 * r / s})
+
+    duty_cycle = {}
+    for node, (cpu, lpm, transmit, listen) in power.items():
+        if cpu + lpm > 0:
+            duty_cycle[str(node)] = 100.0 * (transmit + listen) / (cpu + lpm)
+
+    delivered = len([k for k in sent if k in received])
+    fields = run.split('-')
+    return {
+        'run': run,
+        'mode': fields[0],
+        'level': fields[1] if len(fields) > 1 else None,
+        'seed': fields[2] if len(fields) > 2 else None,
+        'sent': len(sent),
+        'received': delivered,
+        'pdr': 100.0 * delivered / len(sent) if sent else None,
+        'pdr_over_time': pdr_over_time,
+        'latency_ms': {
+            'count': len(latencies),
+            'p50': percentile(latencies, 50),
+            'p90': percentile(latencies, 90),
+            'p95': percentile(latencies, 95),
+            'p99': percentile(latencies, 99),
+            'max': max(latencies) if latencies else None,
+        },
+        'duty_cycle': duty_cycle,
+        'duty_cycle_mean': (sum(duty_cycle.values()) / len(duty_cycle)
+                            if duty_cycle else None),
+        'channel_switches': dict((str(n), c) for n, c in switches.items()),
+        'channel_switches_total': sum(switches.values()),
+        'channel_switches_avoided_total': sum(avoided.values()),
+        'survey_retunes_total': sum(survey.values()),
+        'mac_total': dict((name, sum(v[i] for v in mac.values()))
+                          for i, name in enumerate(MAC_FIELDS)),
+    }
+
+
+def mean(values):
+    values = [v for v in values if v is not None]
+    return sum(values) / len(values) if values else None
+
+
+def summarize(runs):
+    return {
+        'runs': len(runs),
+        'pdr': mean([r['pdr'] for r in runs]),
+        'latency_p50_ms': mean([r['latency_ms']['p50'] for r in runs]),
+        'latency_p95_ms': mean([r['latency_ms']['p95'] for r in runs]),
+        'duty_cycle': mean([r['duty_cycle_mean'] for r in runs]),
+        'channel_switches': mean([r['channel_switches_total'] for r in runs]),
+        'channel_switches_avoided': mean([r.get('channel_switches_avoided_total')
+                                          for r in runs]),
+        'survey_retunes': mean([r.get('survey_retunes_total') for r in runs]),
+    }
+
+
+def compare(files):
+    runs = []
+    for name in files:
+        with open(name) as f:
+            runs.append(json.load(f))
+
+    levels = []
+    for r in runs:
+        if r['level'] not in levels:
+            levels.append(r['level'])
+
+    result = []
+    for level in levels:
+        entry = {'level': level}
+        for mode in ('multichannel', 'single'):
+            group = [r for r in runs if r['level'] == level and r['mode'] == mode]
+            if group:
+                entry[mode] = summarize(group)
+        if 'multichannel' in entry and 'single' in entry:
+            delta = {}
+            for k, v in entry['multichannel'].items():
+                b = entry['single'][k]
+                if k != 'runs' and v is not None and b is not None:
+                    delta[k] = v - b
+            entry['delta'] = delta
+        result.append(entry)
+    return {'levels': result, 'runs': runs}
+
+
+if __name__ == '__main__':
+    if len(sys.argv) > 2 and sys.argv[1] == '--compare':
+        out = compare(sys.argv[2:])
+    elif len(sys.argv) == 2:
+        out = report(sys.argv[1])
+    else:
+        sys.stderr.write(__doc__)
+        sys.exit(1)
+    json.dump(out, sys.stdout, indent=2, sort_keys=True)
+    sys.stdout.write('\n')
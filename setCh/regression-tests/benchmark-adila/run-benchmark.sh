@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+# Runs one benchmark scenario: Cooja headless with the slip-radio on a
+# serial socket, and the native border router attached to it. Every line
+# the border router prints is prefixed with the wall clock in ms.
+#
+# Usage: run-benchmark.sh RUN BORDER-ROUTER
+#
+
+RUN=$1
+LPBR=$2
+CONTIKI=${CONTIKI:-../..}
+SUDO=${SUDO-sudo}
+STARTUP_DELAY=${STARTUP_DELAY:-10}
+LPBR_PORT=${LPBR_PORT:-60001}
+
+rm -f COOJA.testlog
+java -Xshare:on -jar $CONTIKI/tools/cooja/dist/cooja.jar \
+  -nogui=$RUN.csc -contiki=$CONTIKI > $RUN.log 2>&1 &
+COOJA=$!
+
+# Give Cooja time to load the simulation and open the serial socket
+sleep $STARTUP_DELAY
+
+$SUDO ./$LPBR -a 127.0.0.1 -p $LPBR_PORT aaaa::1/64 2>&1 | \
+  perl -MTime::HiRes=time -ne '$| = 1; printf "%d %s", time * 1000, $_' \
+  > $RUN.lpbrlog &
+
+wait $COOJA
+STATUS=$?
+
+$SUDO pkill -f "$LPBR -a 127.0.0.1 -p $LPBR_PORT"
+mv COOJA.testlog $RUN.testlog
+exit $STATUS
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+package se.sics.cooja.radiomediums;
+
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.Random;
+
+import org.apache.log4j.Logger;
+import org.jdom.Element;
+
+import se.sics.cooja.ClassDescription;
+import se.sics.cooja.RadioConnection;
+import se.sics.cooja.Simulation;
+import se.sics.cooja.TimeEvent;
+import se.sics.cooja.interfaces.Position;
+import se.sics.cooja.interfaces.Radio;
+
+/**
+ * UDGM with simulated, per-channel external interference.
+ *
+ * Each interferer is a fixed point in space with a radius and an output
+ * power. It alternates between a clear and an interference state
+ * following a two-state Markov chain: the time spent in each state is
+ * exponentially distributed with a configurable mean (the bursty
+ * interference model by Boano et al.). An interferer either stays on
+ * one channel, or picks a new random channel (11-26) for every burst.
+ *
+ * While a burst is active, a radio within the radius senses the
+ * interference power, decreasing linearly with the distance down to
+ * {@link #SS_WEAK} at the border. Radios on other channels sense the
+ * power attenuated by the adjacent channel leakage, given in dB per
+ * channel offset. A radio sensing more than the configured threshold
+ * reports a busy channel and fails any reception overlapping the burst.
+ *
+ * The bursts are drawn from a random generator of their own, seeded
+ * from the simulation seed unless an explicit seed is configured, so
+ * the interference pattern does not depend on what the motes do.
+ *
+ * All parameters are read from and written to the simulation config:
+ * <pre>
+ * &lt;interference_seed&gt;123456&lt;/interference_seed&gt;
+ * &lt;interference_threshold&gt;-95.0&lt;/interference_threshold&gt;
+ * &lt;adjacent_leakage&gt;0 30 45 55&lt;/adjacent_leakage&gt;
+ * &lt;interferer&gt;
+ *   &lt;channel&gt;random&lt;/channel&gt;
+ *   &lt;x&gt;50.0&lt;/x&gt; &lt;y&gt;50.0&lt;/y&gt; &lt;z&gt;0.0&lt;/z&gt;
+ *   &lt;radius&gt;60.0&lt;/radius&gt;
+ *   &lt;power&gt;-10.0&lt;/power&gt;
+ *   &lt;mean_clear&gt;200.0&lt;/mean_clear&gt;
+ *   &lt;mean_burst&gt;20.0&lt;/mean_burst&gt;
+ * &lt;/interferer&gt;
+ * </pre>
+ * Durations are in milliseconds.
+ *
+ * @see UDGM
+ */
+@ClassDescription("UDGM: Multichannel Interference")
+public class UDGMInterference extends UDGM {
+  private static Logger logger = Logger.getLogger(UDGMInterference.class);
+
+  public static final int CHANNEL_MIN = 11;
+  public static final int CHANNEL_MAX = 26;
+  public static final int CHANNEL_RANDOM = -1;
+
+  /* Radios sensing interference above this power are disturbed */
+  public double INTERFERENCE_THRESHOLD = SS_WEAK;
+
+  /* Attenuation [dB] of interference on a channel offset, indexed by
+   * the offset. Offsets beyond the last entry are not affected. */
+  public double[] ADJACENT_LEAKAGE = new double[] { 0, 30, 45 };
+
+  private Simulation simulation;
+  private ArrayList<Interferer> interferers = new ArrayList<Interferer>();
+
+  private boolean seedConfigured = false;
+  private long seed;
+  private Random burstRandom = new Random();
+
+  /**
+   * A single interference source.
+   */
+  public class Interferer {
+    public int channel = CHANNEL_RANDOM;
+    public double x = 0, y = 0, z = 0;
+    public double radius = 50;
+    public double power = SS_STRONG;
+    public double meanClear = 200; /* ms */
+    public double meanBurst = 20; /* ms */
+
+    private boolean bursting = false;
+    private int burstChannel = CHANNEL_MIN;
+    private long bursts = 0;
+
+    private TimeEvent toggleEvent = new TimeEvent(0, "interference burst") {
+      public void execute(long t) {
+        toggle(t);
+      }
+    };
+
+    public boolean isBursting() {
+      return bursting;
+    }
+
+    public int getBurstChannel() {
+      return burstChannel;
+    }
+
+    public long getBursts() {
+      return bursts;
+    }
+
+    private void toggle(long t) {
+      bursting = !bursting;
+      if (bursting) {
+        bursts++;
+        if (channel == CHANNEL_RANDOM) {
+          burstChannel = CHANNEL_MIN
+            + burstRandom.nextInt(CHANNEL_MAX - CHANNEL_MIN + 1);
+        } else {
+          burstChannel = channel;
+        }
+        burstStarted(this);
+      }
+      updateSignalStrengths();
+      schedule(t);
+    }
+
+    private void schedule(long now) {
+      double mean = bursting ? meanBurst : meanClear;
+      long duration = (long) (-Math.log(1.0 - burstRandom.nextDouble())
+          * mean * Simulation.MILLISECOND);
+      simulation.scheduleEvent(toggleEvent, now + Math.max(1, duration));
+    }
+
+    /**
+     * @param radio Radio
+     * @return Interference power sensed by radio, or SS_NOTHING
+     */
+    public double getPowerAt(Radio radio) {
+      if (!bursting || radius <= 0) {
+        return SS_NOTHING;
+      }
+      Position pos = radio.getPosition();
+      double dx = pos.getXCoordinate() - x;
+      double dy = pos.getYCoordinate() - y;
+      double dz = pos.getZCoordinate() - z;
+      double distFactor = Math.sqrt(dx*dx + dy*dy + dz*dz) / radius;
+      if (distFactor > 1.0) {
+        return SS_NOTHING;
+      }
+
+      int offset = 0;
+      if (radio.getChannel() >= 0) {
+        offset = Math.abs(radio.getChannel() - burstChannel);
+      }
+      if (offset >= ADJACENT_LEAKAGE.length) {
+        return SS_NOTHING;
+      }
+
+      return power + distFactor*(SS_WEAK - power) - ADJACENT_LEAKAGE[offset];
+    }
+  }
+
+  public UDGMInterference(Simulation simulation) {
+    super(simulation);
+    this.simulation = simulation;
+    restart();
+  }
+
+  public void removed() {
+    super.removed();
+
+    for (Interferer i: interferers) {
+      i.toggleEvent.remove();
+    }
+  }
+
+  public Interferer[] getInterferers() {
+    return interferers.toArray(new Interferer[0]);
+  }
+
+  /**
+   * @param radio Radio
+   * @return Strongest interference power currently sensed by radio
+   */
+  public double getInterferencePower(Radio radio) {
+    double strongest = SS_NOTHING;
+    for (Interferer i: interferers) {
+      strongest = Math.max(strongest, i.getPowerAt(radio));
+    }
+    return strongest;
+  }
+
+  /**
+   * @param radio Radio
+   * @return True iff radio currently senses interference above threshold
+   */
+  public boolean isInterferedByBurst(Radio radio) {
+    return getInterferencePower(radio) >= INTERFERENCE_THRESHOLD;
+  }
+
+  /* Restarts all interferers in the clear state. Restarting with the same
+   * seed reproduces the same sequence of bursts. */
+  private void restart() {
+    simulation.invokeSimulationThread(new Runnable() {
+      public void run() {
+        burstRandom.setSeed(seedConfigured ? seed : simulation.getRandomSeed());
+        long now = simulation.getSimulationTime();
+        for (Interferer i: interferers) {
+          i.toggleEvent.remove();
+          i.bursting = false;
+          i.bursts = 0;
+          i.schedule(now);
+        }
+        updateSignalStrengths();
+      }
+    });
+  }
+
+  private void burstStarted(Interferer interferer) {
+    /* Corrupt ongoing receptions */
+    RadioConnection[] conns = getActiveConnections();
+    for (Radio radio: getRegisteredRadios()) {
+      if (!radio.isReceiving() ||
+          interferer.getPowerAt(radio) < INTERFERENCE_THRESHOLD) {
+        continue;
+      }
+      radio.interfereAnyReception();
+      for (RadioConnection conn: conns) {
+        if (conn.isDestination(radio)) {
+          conn.addInterfered(radio);
+        }
+      }
+    }
+  }
+
+  public double getRxSuccessProbability(Radio source, Radio dest) {
+    if (isInterferedByBurst(dest)) {
+      return 0.0;
+    }
+    return super.getRxSuccessProbability(source, dest);
+  }
+
+  public void updateSignalStrengths() {
+    super.updateSignalStrengths();
+
+    /* Interference is sensed on top of any ongoing transmissions */
+    for (Radio radio: getRegisteredRadios()) {
+      double power = getInterferencePower(radio);
+      if (power >= INTERFERENCE_THRESHOLD &&
+          radio.getCurrentSignalStrength() < power) {
+        radio.setCurrentSignalStrength(power);
+      }
+    }
+  }
+
+  public Collection<Element> getConfigXML() {
+    Collection<Element> config = super.getConfigXML();
+    Element element;
+
+    if (seedConfigured) {
+      element = new Element("interference_seed");
+      element.setText(Long.toString(seed));
+      config.add(element);
+    }
+
+    element = new Element("interference_threshold");
+    element.setText(Double.toString(INTERFERENCE_THRESHOLD));
+    config.add(element);
+
+    StringBuilder leakage = new StringBuilder();
+    for (double l: ADJACENT_LEAKAGE) {
+      if (leakage.length() > 0) {
+        leakage.append(' ');
+      }
+      leakage.append(l);
+    }
+    element = new Element("adjacent_leakage");
+    element.setText(leakage.toString());
+    config.add(element);
+
+    for (Interferer i: interferers) {
+      element = new Element("interferer");
+      element.addContent(new Element("channel").setText(
+          i.channel == CHANNEL_RANDOM ? "random" : Integer.toString(i.channel)));
+      element.addContent(new Element("x").setText(Double.toString(i.x)));
+      element.addContent(new Element("y").setText(Double.toString(i.y)));
+      element.addContent(new Element("z").setText(Double.toString(i.z)));
+      element.addContent(new Element("radius").setText(Double.toString(i.radius)));
+      element.addContent(new Element("power").setText(Double.toString(i.power)));
+      element.addContent(new Element("mean_clear").setText(Double.toString(i.meanClear)));
+      element.addContent(new Element("mean_burst").setText(Double.toString(i.meanBurst)));
+      config.add(element);
+    }
+
+    return config;
+  }
+
+  public boolean setConfigXML(Collection<Element> configXML, boolean visAvailable) {
+    if (!super.setConfigXML(configXML, visAvailable)) {
+      return false;
+    }
+
+    for (Element element : configXML) {
+      if (element.getName().equals("interference_seed")) {
+        seed = Long.parseLong(element.getText());
+        seedConfigured = true;
+      }
+
+      if (element.getName().equals("interference_threshold")) {
+        INTERFERENCE_THRESHOLD = Double.parseDouble(element.getText());
+      }
+
+      if (element.getName().equals("adjacent_leakage")) {
+        String[] values = element.getText().trim().split("\\s+");
+        ADJACENT_LEAKAGE = new double[values.length];
+        for (int j = 0; j < values.length; j++) {
+          ADJACENT_LEAKAGE[j] = Double.parseDouble(values[j]);
+        }
+      }
+
+      if (element.getName().equals("interferer")) {
+        Interferer i = new Interferer();
+        for (Object o: element.getChildren()) {
+          Element e = (Element) o;
+          String name = e.getName();
+          String text = e.getText().trim();
+          if (name.equals("channel")) {
+            i.channel = text.equals("random") ? CHANNEL_RANDOM : Integer.parseInt(text);
+          } else if (name.equals("x")) {
+            i.x = Double.parseDouble(text);
+          } else if (name.equals("y")) {
+            i.y = Double.parseDouble(text);
+          } else if (name.equals("z")) {
+            i.z = Double.parseDouble(text);
+          } else if (name.equals("radius")) {
+            i.radius = Double.parseDouble(text);
+          } else if (name.equals("power")) {
+            i.power = Double.parseDouble(text);
+          } else if (name.equals("mean_clear")) {
+            i.meanClear = Double.parseDouble(text);
+          } else if (name.equals("mean_burst")) {
+            i.meanBurst = Double.parseDouble(text);
+          } else {
+            logger.warn("Unknown interferer parameter: " + name);
+          }
+        }
+        if (i.channel != CHANNEL_RANDOM &&
+            (i.channel < CHANNEL_MIN || i.channel > CHANNEL_MAX)) {
+          logger.fatal("Bad interferer channel: " + i.channel);
+          return false;
+        }
+        interferers.add(i);
+      }
+    }
+
+    restart();
+    return true;
+  }
+
+}
@@ -88,6 +88,13 @@ struct radio_driver {
 
   /** Turn the radio off. */
   int (* off)(void);
+
+  /** Tune the radio to an IEEE 802.15.4 channel. The driver may wait
+      with the retune until it next listens or transmits. Optional. */
+  int (* set_channel)(int channel);
+
+  /** Get the channel set last. Optional. */
+  int (* get_channel)(void);
 };
 
 /* Generic radio return values. */
@@ -91,13 +91,43 @@ MEMB(connections, struct connection, 16);
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
-                                          (void *)CC_CONCAT(name,_memb_mem)}
+                                          (void *)CC_CONCAT(name,_memb_mem), \
+                                          0, 0}
+
+/**
+ * Declare a memory block with a free list.
+ *
+ * Works like MEMB(), but memb_alloc() and memb_free() take constant
+ * time instead of scanning the blocks, for an extra unsigned short per
+ * block.
+ *
+ * \param name The name of the memory block.
+ *
+ * \param structure The name of the struct that the memory block holds
+ *
+ * \param num The total number of memory chunks in the block.
+ *
+ */
+#define MEMB_FREELIST(name, structure, num) \
+        static char CC_CONCAT(name,_memb_count)[num]; \
+        static structure CC_CONCAT(name,_memb_mem)[num]; \
+        static unsigned short CC_CONCAT(name,_memb_next)[num]; \
+        static struct memb name = {sizeof(structure), num, \
+                                          CC_CONCAT(name,_memb_count), \
+                                          (void *)CC_CONCAT(name,_memb_mem), \
+                                          CC_CONCAT(name,_memb_next), 0}
 
 struct memb {
   unsigned short size;
   unsigned short num;
   char *count;
   void *mem;
+  /* Free list of a MEMB_FREELIST(): the first free block, and for each
+     free block the one after it plus one, or 0 for the block at the
+     next index. A zeroed free list thus holds all blocks in order, and
+     num ends the list. */
+  unsigned short *next;
+  unsigned short free;
 };
 
 /**
@@ -0,0 +1,363 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Per-neighbor, per-channel link estimator
+ */
+
+#include "net/channel-estimator.h"
+#include "net/nbr-table.h"
+#include "net/packetbuf.h"
+#include "net/mac/mac.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else /* DEBUG */
+#define PRINTF(...)
+#endif /* DEBUG */
+
+/* Weight of the previous estimate, in eighths */
+#ifdef CHANNEL_ESTIMATOR_CONF_ALPHA
+#define ALPHA CHANNEL_ESTIMATOR_CONF_ALPHA
+#else
+#define ALPHA 6
+#endif
+
+/* Transmissions charged for a packet that was dropped */
+#ifdef CHANNEL_ESTIMATOR_CONF_NOACK_PENALTY
+#define NOACK_PENALTY CHANNEL_ESTIMATOR_CONF_NOACK_PENALTY
+#else
+#define NOACK_PENALTY 8
+#endif
+
+/* A channel nothing is known about looks like ETX 2 and 50% PRR, so
+   that it ranks below channels measured good and above measured bad */
+#define INIT_ETX (2 * CHANNEL_ESTIMATOR_ETX_DIVISOR)
+#define INIT_PRR 127
+
+#define IN_RANGE(ch) ((ch) >= CHANNEL_ESTIMATOR_FIRST_CHANNEL && \
+                      (ch) <= CHANNEL_ESTIMATOR_LAST_CHANNEL)
+/*---------------------------------------------------------------------------*/
+static uint8_t
+ewma(uint8_t old, uint16_t sample, uint8_t first)
+{
+  if(sample > 255) {
+    sample = 255;
+  }
+  if(first) {
+    return sample;
+  }
+  return ((uint16_t)old * ALPHA + sample * (8 - ALPHA)) / 8;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_sample(struct channel_estimate *e, uint16_t etx, uint8_t prr)
+{
+  e->etx = ewma(e->etx, etx, e->samples == 0);
+  e->prr = ewma(e->prr, prr, e->samples == 0);
+  if(e->samples < 255) {
+    e->samples++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_estimate_init(struct channel_estimate *e)
+{
+  e->etx = INIT_ETX;
+  e->prr = INIT_PRR;
+  e->rssi = 0;
+  e->lqi = 0;
+  e->samples = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_estimate_tx(struct channel_estimate *e, int status,
+                    int num_transmissions)
+{
+  if(num_transmissions < 1) {
+    num_transmissions = 1;
+  }
+  switch(status) {
+  case MAC_TX_OK:
+    add_sample(e, num_transmissions * CHANNEL_ESTIMATOR_ETX_DIVISOR,
+               CHANNEL_ESTIMATOR_PRR_MAX / num_transmissions);
+    break;
+  case MAC_TX_NOACK:
+  case MAC_TX_COLLISION:
+    if(num_transmissions < NOACK_PENALTY) {
+      num_transmissions = NOACK_PENALTY;
+    }
+    add_sample(e, num_transmissions * CHANNEL_ESTIMATOR_ETX_DIVISOR, 0);
+    break;
+  default:
+    /* Deferred or not sent at all: says nothing about the link */
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_estimate_rx(struct channel_estimate *e, int8_t rssi, uint8_t lqi)
+{
+  if(e->lqi == 0) {
+    e->rssi = rssi;
+    e->lqi = lqi;
+  } else {
+    e->rssi = ((int16_t)e->rssi * ALPHA + (int16_t)rssi * (8 - ALPHA)) / 8;
+    e->lqi = ewma(e->lqi, lqi, 0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_estimate_probe(struct channel_estimate *e, uint8_t received,
+                       uint8_t sent)
+{
+  if(sent == 0) {
+    return;
+  }
+  if(received > sent) {
+    received = sent;
+  }
+  add_sample(e, received == 0 ? 255 :
+             ((uint16_t)sent * CHANNEL_ESTIMATOR_ETX_DIVISOR) / received,
+             ((uint16_t)received * CHANNEL_ESTIMATOR_PRR_MAX) / sent);
+}
+/*---------------------------------------------------------------------------*/
+/* Mean of the PRR and the inverse ETX, both on the 0..255 scale */
+uint8_t
+channel_estimate_score(const struct channel_estimate *e)
+{
+  uint16_t etx;
+
+  etx = e->etx < CHANNEL_ESTIMATOR_ETX_DIVISOR ?
+    CHANNEL_ESTIMATOR_ETX_DIVISOR : e->etx;
+  return ((uint16_t)e->prr +
+          (CHANNEL_ESTIMATOR_PRR_MAX * CHANNEL_ESTIMATOR_ETX_DIVISOR) / etx) / 2;
+}
+/*---------------------------------------------------------------------------*/
+static int
+better(const struct channel_estimate *a, const struct channel_estimate *b)
+{
+  uint8_t sa, sb;
+
+  sa = channel_estimate_score(a);
+  sb = channel_estimate_score(b);
+  if(sa != sb) {
+    return sa > sb;
+  }
+  return a->lqi > b->lqi;
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_estimate_rank(const struct channel_estimate *estimates,
+                      uint8_t *channels, int max)
+{
+  int i, n;
+  uint8_t c;
+
+  /* Insertion sort, stable so that equal channels keep their order */
+  n = 0;
+  for(c = 0; c < CHANNEL_ESTIMATOR_NUM_CHANNELS; c++) {
+    for(i = n; i > 0; i--) {
+      if(!better(&estimates[c],
+                 &estimates[channels[i - 1] - CHANNEL_ESTIMATOR_FIRST_CHANNEL])) {
+        break;
+      }
+      if(i < max) {
+        channels[i] = channels[i - 1];
+      }
+    }
+    if(i < max) {
+      channels[i] = c + CHANNEL_ESTIMATOR_FIRST_CHANNEL;
+      if(n < max) {
+        n++;
+      }
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+#if CHANNEL_ESTIMATOR_ENABLED
+
+struct nbr_estimates {
+  struct channel_estimate ch[CHANNEL_ESTIMATOR_NUM_CHANNELS];
+};
+
+NBR_TABLE(struct nbr_estimates, channel_estimates);
+
+static uint8_t initialized;
+/*---------------------------------------------------------------------------*/
+void
+channel_estimator_init(void)
+{
+  if(!initialized) {
+    initialized = nbr_table_register(channel_estimates, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct channel_estimate *
+lookup(const rimeaddr_t *lladdr, uint8_t channel, int add)
+{
+  struct nbr_estimates *n;
+  int c;
+
+  if(!initialized || lladdr == NULL || !IN_RANGE(channel) ||
+     rimeaddr_cmp(lladdr, &rimeaddr_null)) {
+    return NULL;
+  }
+  n = nbr_table_get_from_lladdr(channel_estimates, lladdr);
+  if(n == NULL && add) {
+    n = nbr_table_add_lladdr(channel_estimates, lladdr);
+    if(n != NULL) {
+      for(c = 0; c < CHANNEL_ESTIMATOR_NUM_CHANNELS; c++) {
+        channel_estimate_init(&n->ch[c]);
+      }
+    }
+  }
+  return n == NULL ? NULL :
+    &n->ch[channel - CHANNEL_ESTIMATOR_FIRST_CHANNEL];
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_estimator_tx(const rimeaddr_t *dest, uint8_t channel,
+                     int status, int num_transmissions)
+{
+  struct channel_estimate *e;
+
+  e = lookup(dest, channel, 1);
+  if(e != NULL) {
+    channel_estimate_tx(e, status, num_transmissions);
+    PRINTF("channel-estimator: tx ch %u etx %u prr %u\n",
+           channel, e->etx, e->prr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_estimator_rx(const rimeaddr_t *src, uint8_t channel)
+{
+  struct channel_estimate *e;
+
+  /* Only neighbors we already track, so that overheard frames do not
+     push other entries out of the neighbor table */
+  e = lookup(src, channel, 0);
+  if(e != NULL) {
+    channel_estimate_rx(e, (int8_t)packetbuf_attr(PACKETBUF_ATTR_RSSI),
+                        (uint8_t)packetbuf_attr(PACKETBUF_ATTR_LINK_QUALITY));
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_estimator_probe(const rimeaddr_t *nbr, uint8_t channel,
+                        uint8_t received, uint8_t sent)
+{
+  struct channel_estimate *e;
+
+  e = lookup(nbr, channel, 1);
+  if(e != NULL) {
+    channel_estimate_probe(e, received, sent);
+  }
+}
+/*---------------------------------------------------------------------------*/
+const struct channel_estimate *
+channel_estimator_get(const rimeaddr_t *nbr, uint8_t channel)
+{
+  return lookup(nbr, channel, 0);
+}
+/*---------------------------------------------------------------------------*/
+/* Average of the measured estimates towards all neighbors on each
+   channel; channels nobody was measured on keep the initial estimate */
+static void
+aggregate(struct channel_estimate *out)
+{
+  struct nbr_estimates *n;
+  uint16_t etx[CHANNEL_ESTIMATOR_NUM_CHANNELS];
+  uint16_t prr[CHANNEL_ESTIMATOR_NUM_CHANNELS];
+  uint16_t lqi[CHANNEL_ESTIMATOR_NUM_CHANNELS];
+  uint8_t count[CHANNEL_ESTIMATOR_NUM_CHANNELS];
+  int c;
+
+  for(c = 0; c < CHANNEL_ESTIMATOR_NUM_CHANNELS; c++) {
+    etx[c] = prr[c] = lqi[c] = 0;
+    count[c] = 0;
+    channel_estimate_init(&out[c]);
+  }
+  if(!initialized) {
+    return;
+  }
+
+  for(n = nbr_table_head(channel_estimates); n != NULL;
+      n = nbr_table_next(channel_estimates, n)) {
+    for(c = 0; c < CHANNEL_ESTIMATOR_NUM_CHANNELS; c++) {
+      if(n->ch[c].samples > 0) {
+        etx[c] += n->ch[c].etx;
+        prr[c] += n->ch[c].prr;
+        lqi[c] += n->ch[c].lqi;
+        count[c]++;
+      }
+    }
+  }
+
+  for(c = 0; c < CHANNEL_ESTIMATOR_NUM_CHANNELS; c++) {
+    if(count[c] > 0) {
+      out[c].etx = etx[c] / count[c];
+      out[c].prr = prr[c] / count[c];
+      out[c].lqi = lqi[c] / count[c];
+      out[c].samples = count[c];
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_estimator_rank(uint8_t *channels, int max)
+{
+  struct channel_estimate all[CHANNEL_ESTIMATOR_NUM_CHANNELS];
+
+  aggregate(all);
+  return channel_estimate_rank(all, channels, max);
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_estimator_usable(uint8_t channel)
+{
+  struct channel_estimate all[CHANNEL_ESTIMATOR_NUM_CHANNELS];
+
+  if(!IN_RANGE(channel)) {
+    return 0;
+  }
+  aggregate(all);
+  return all[channel - CHANNEL_ESTIMATOR_FIRST_CHANNEL].prr >=
+    CHANNEL_ESTIMATOR_USABLE_PRR;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* CHANNEL_ESTIMATOR_ENABLED */
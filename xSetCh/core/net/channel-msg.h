@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Compact on-air encoding of the multichannel control messages
+ *         exchanged between the nodes and the LPBR.
+ *
+ *         A message is a header byte (dispatch and version), the message
+ *         type and a list of tag-length-value fields. Fields that are zero
+ *         are left out, and addresses under the link-local or the network
+ *         prefix are sent as their 8-byte interface identifier.
+ */
+
+#ifndef CHANNEL_MSG_H
+#define CHANNEL_MSG_H
+
+#include "net/uip.h"
+#include "net/mac/spectrum-survey.h"
+
+/* Message types, shared by the nodes and the LPBR */
+enum {
+  CH_CHANGE,
+  NBR_CH_CHANGE,
+  STARTPROBE,
+  NBRPROBE,
+  PROBERESULT,
+  CONFIRM_CH,
+  GET_ACK,
+  SENTRECV,
+  SEND_NBR,
+  SEND_CH,
+  CH_REQUEST,
+  CH_SCHEDULE,
+  NBR_CH_SCHEDULE,
+  SCHEDULE_ACK,
+  CH_ABORT,
+  SURVEY,
+  SCHEDULE_NACK,
+  CHANNEL_MSG_NUM_TYPES
+};
+
+/* Type of a buffer that is not a control message */
+#define CHANNEL_MSG_NONE 0xff
+
+/* The upper bits keep the header out of the printable range, so that
+   plain text data is never taken for a control message */
+#define CHANNEL_MSG_DISPATCH 0xe0
+#define CHANNEL_MSG_VERSION  1
+
+/* Header, type, value, value2 and a full address. No message type
+   carries both an address and a survey. */
+#define CHANNEL_MSG_MAX_LEN (2 + 3 + 3 + 2 + 16)
+
+/* Prefix of the addresses that are sent as interface identifier only */
+#ifdef CHANNEL_MSG_CONF_PREFIX
+#define CHANNEL_MSG_PREFIX CHANNEL_MSG_CONF_PREFIX
+#else
+#define CHANNEL_MSG_PREFIX 0xaaaa, 0, 0, 0
+#endif
+
+struct channel_msg {
+  uint8_t type;
+  uint8_t value;
+  uint8_t value2;
+  /* Milliseconds, so that nodes with different clock rates agree */
+  uint16_t time;
+  uip_ipaddr_t address;
+  /* A packed spectrum survey, present when survey_len is
+     SPECTRUM_SURVEY_REPORT_LEN */
+  uint8_t survey_len;
+  uint8_t survey[SPECTRUM_SURVEY_REPORT_LEN];
+};
+
+/**
+ * \brief      Encode a control message
+ * \param buf  The buffer to encode into
+ * \param size The size of the buffer, at least CHANNEL_MSG_MAX_LEN
+ * \param msg  The message
+ * \return     The length of the encoded message, or 0 if it did not fit
+ *
+ *             Only the fields the message type carries are encoded, so
+ *             fields the sender left unset never go on air.
+ */
+int channel_msg_encode(uint8_t *buf, int size, const struct channel_msg *msg);
+
+/**
+ * \brief      Decode a control message
+ * \param msg  The message to fill in
+ * \param buf  The received data
+ * \param len  The length of the received data
+ * \return     Non-zero if the data was a control message of this version
+ *
+ *             Fields that were left out decode as zero. Unknown fields are
+ *             skipped. On failure msg->type is set to CHANNEL_MSG_NONE.
+ */
+int channel_msg_decode(struct channel_msg *msg, const uint8_t *buf, int len);
+
+#endif /* CHANNEL_MSG_H */
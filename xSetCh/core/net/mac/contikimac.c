@@ -45,14 +45,14 @@
 #include "dev/watchdog.h"
 #include "lib/random.h"
 #include "net/mac/contikimac.h"
+#include "net/mac/nbr-channel.h"
+#include "net/mac/radio-channel.h"
 #include "net/netstack.h"
 #include "net/rime.h"
 #include "sys/compower.h"
 #include "sys/pt.h"
 #include "sys/rtimer.h"
 
-#include "net/mac/simplified_nbr_table.h"
-
 #include <string.h>
 
 /* TX/RX cycles are synchronized with neighbor wake periods */
@@ -96,6 +96,9 @@
 struct hdr {
   uint8_t id;
   uint8_t len;
+  /* The channel the sender listens on, so that neighbors learn it from
+     any frame */
+  uint8_t channel;
 };
 #endif /* WITH_CONTIKIMAC_HEADER */
 
@@ -538,7 +541,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
 	    struct rdc_buf_list *buf_list,
             int is_receiver_awake)
 {
-  uint8_t theChIs = 0;
+  uint8_t channel;
 
   rtimer_clock_t t0;
   rtimer_clock_t encounter_time = 0;
@@ -555,6 +558,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   uint8_t seqno;
 #if WITH_CONTIKIMAC_HEADER
   struct hdr *chdr;
+  uint8_t listen_channel;
 #endif /* WITH_CONTIKIMAC_HEADER */
 
   /* Exit if RDC and radio were explicitly turned off */
@@ -572,13 +576,19 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   /* If NETSTACK_CONF_BRIDGE_MODE is set, assume PACKETBUF_ADDR_SENDER is already set. */
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &rimeaddr_node_addr);
 #endif
+#if WITH_CONTIKIMAC_HEADER
+  /* The channel we listen on is the one the radio is on before it
+     retunes to the receiver's. 0 if the radio cannot tell, and
+     neighbors then learn nothing from the header. */
+  listen_channel = radio_channel_get();
+#endif /* WITH_CONTIKIMAC_HEADER */
   if(rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &rimeaddr_null)) {
     is_broadcast = 1;
     PRINTDEBUG("contikimac: send broadcast\n");
 
     //ADILA EDIT 14/09/15
     /* If sending a broadcast packet, default channel, 26 is used */
-    cc2420_set_channel(26);
+    radio_channel_set(26);
     //printf("CHANNEL %d\n\n", cc2420_get_channel());
 
     if(broadcast_rate_drop()) {
@@ -596,10 +606,13 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
                packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[6],
                packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[7]);
 
-    //ADILA EDIT 16/02/15
-    /* Call simplified_getCh(...) to get the channel of the receiver */
-    theChIs = simplified_getCh(packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[6], packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[7]);
-    cc2420_set_channel(theChIs);
+    /* Transmit on the channel the receiver listens on, as given to us
+       by the border router. The cache is keyed on the full link-layer
+       address. */
+    channel = nbr_channel_get(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    if(channel != NBR_CHANNEL_UNKNOWN) {
+      radio_channel_set(channel);
+    }
 
     //ADILA EDIT JULY 15
     //printf("XSETCH CONTIKIMAC %d\n\n", cc2420_get_channel());
@@ -625,6 +638,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   chdr = packetbuf_hdrptr();
   chdr->id = CONTIKIMAC_ID;
   chdr->len = hdrlen;
+  chdr->channel = listen_channel;
   
   /* Create the MAC header for the data packet. */
   hdrlen = NETSTACK_FRAMER.create();
@@ -971,6 +985,7 @@ input_packet(void)
       PRINTF("contikimac: failed to parse hdr (%u)\n", packetbuf_totlen());
       return;
     }
+    packetbuf_set_attr(PACKETBUF_ATTR_SENDER_CHANNEL, chdr->channel);
     packetbuf_hdrreduce(sizeof(struct hdr));
     packetbuf_set_datalen(chdr->len);
 #endif /* WITH_CONTIKIMAC_HEADER */
@@ -1058,6 +1073,7 @@ init(void)
   phase_init();
 #endif /* WITH_PHASE_OPTIMIZATION */
 
+  nbr_channel_init();
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -94,7 +94,7 @@ struct neighbor_queue {
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions, deferrals;
-  LIST_STRUCT(queued_packet_list);
+  LIST_TAIL_STRUCT(queued_packet_list);
 };
 
 /* The maximum number of co-existing neighbor queues */
@@ -105,9 +105,9 @@ struct neighbor_queue {
 #endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
 
 #define MAX_QUEUED_PACKETS QUEUEBUF_NUM
-MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
-MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
-MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
+MEMB_FREELIST(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
+MEMB_FREELIST(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
+MEMB_FREELIST(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
 LIST(neighbor_list);
 
 static void packet_sent(void *ptr, int status, int num_transmissions);
@@ -164,7 +164,7 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
 {
   if(p != NULL) {
     /* Remove packet from list and deallocate */
-    list_remove(n->queued_packet_list, p);
+    list_tail_remove(n->queued_packet_list, p);
 
     queuebuf_free(p->buf);
     memb_free(&metadata_memb, p->ptr);
@@ -325,7 +325,7 @@ send_packet(mac_callback_t sent, void *ptr)
       n->collisions = 0;
       n->deferrals = 0;
       /* Init packet list for this neighbor */
-      LIST_STRUCT_INIT(n, queued_packet_list);
+      LIST_TAIL_STRUCT_INIT(n, queued_packet_list);
       /* Add neighbor to the list */
       list_add(neighbor_list, n);
     }
@@ -353,9 +353,9 @@ send_packet(mac_callback_t sent, void *ptr)
 
 	  if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
 	     PACKETBUF_ATTR_PACKET_TYPE_ACK) {
-	    list_push(n->queued_packet_list, q);
+	    list_tail_push(n->queued_packet_list, q);
 	  } else {
-	    list_add(n->queued_packet_list, q);
+	    list_tail_add(n->queued_packet_list, q);
 	  }
 
 	  /* If q is the first packet in the neighbor's queue, send asap */
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Link-layer address keyed cache of the channel each neighbor
+ *         listens on, consulted by the RDC layer before transmitting
+ */
+
+#ifndef NBR_CHANNEL_H
+#define NBR_CHANNEL_H
+
+#include "net/rime/rimeaddr.h"
+
+/* Returned by nbr_channel_get() for neighbors without a known channel */
+#define NBR_CHANNEL_UNKNOWN 0
+
+void nbr_channel_init(void);
+int nbr_channel_set(const rimeaddr_t *lladdr, uint8_t channel);
+uint8_t nbr_channel_get(const rimeaddr_t *lladdr);
+/* Records the outcome of a unicast to the neighbor, returns the number
+   of unacknowledged transmissions in a row */
+uint8_t nbr_channel_tx(const rimeaddr_t *lladdr, int acked);
+void nbr_channel_remove(const rimeaddr_t *lladdr);
+/* Iterates over the cached neighbors, starting with prev == NULL.
+   Returns the next neighbor and its channel, or NULL at the end. */
+const rimeaddr_t *nbr_channel_next(const rimeaddr_t *prev, uint8_t *channel);
+
+#endif /* NBR_CHANNEL_H */
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Channel changes through the radio driver interface. The
+ *         driver may delay a retune until it next uses the radio; here
+ *         requests that would not change anything are filtered out.
+ */
+
+#include "net/mac/radio-channel.h"
+#include "net/netstack.h"
+
+#include <stddef.h>
+
+struct radio_channel_stats radio_channel_stats;
+/*---------------------------------------------------------------------------*/
+int
+radio_channel_set(int channel)
+{
+  radio_channel_stats.requests++;
+
+  if(NETSTACK_RADIO.set_channel == NULL) {
+    return 0;
+  }
+  if(radio_channel_get() == channel) {
+    radio_channel_stats.skipped++;
+    return 1;
+  }
+  return NETSTACK_RADIO.set_channel(channel);
+}
+/*---------------------------------------------------------------------------*/
+int
+radio_channel_get(void)
+{
+  if(NETSTACK_RADIO.get_channel == NULL) {
+    return RADIO_CHANNEL_UNKNOWN;
+  }
+  return NETSTACK_RADIO.get_channel();
+}
+/*---------------------------------------------------------------------------*/
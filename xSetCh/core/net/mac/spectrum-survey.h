@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Background energy-detect survey of channels 11-26. The RDC
+ *         layer takes one RSSI sample on the next channel in turn while
+ *         the radio is idle, and the survey keeps a noise floor and an
+ *         occupancy estimate per channel.
+ */
+
+#ifndef SPECTRUM_SURVEY_H
+#define SPECTRUM_SURVEY_H
+
+#include "contiki.h"
+
+#define SPECTRUM_SURVEY_FIRST_CHANNEL 11
+#define SPECTRUM_SURVEY_LAST_CHANNEL  26
+#define SPECTRUM_SURVEY_NUM_CHANNELS  (SPECTRUM_SURVEY_LAST_CHANNEL - \
+                                       SPECTRUM_SURVEY_FIRST_CHANNEL + 1)
+
+/* A packed report is one byte per channel: occupancy in the high
+   nibble (0-15) and the noise floor in the low nibble, in 4 dB steps
+   from SPECTRUM_SURVEY_FLOOR_MIN dBm */
+#define SPECTRUM_SURVEY_REPORT_LEN SPECTRUM_SURVEY_NUM_CHANNELS
+#define SPECTRUM_SURVEY_FLOOR_MIN  -100
+#define SPECTRUM_SURVEY_FLOOR_STEP 4
+
+#define SPECTRUM_SURVEY_REPORT_OCCUPANCY(report, ch) \
+  ((report)[(ch) - SPECTRUM_SURVEY_FIRST_CHANNEL] >> 4)
+#define SPECTRUM_SURVEY_REPORT_FLOOR(report, ch) \
+  (SPECTRUM_SURVEY_FLOOR_MIN + SPECTRUM_SURVEY_FLOOR_STEP * \
+   ((report)[(ch) - SPECTRUM_SURVEY_FIRST_CHANNEL] & 0x0f))
+
+void spectrum_survey_init(void);
+
+/* Take one sample on the next channel. Only call this while the radio
+   is off and no transmission or reception is in progress. */
+void spectrum_survey_sample(void);
+
+/* Noise floor in dBm, and share of samples above the busy threshold
+   (0-255), for a channel in 11-26 */
+int spectrum_survey_noise_floor(uint8_t channel);
+uint8_t spectrum_survey_occupancy(uint8_t channel);
+
+void spectrum_survey_pack(uint8_t *report);
+
+#endif /* SPECTRUM_SURVEY_H */
@@ -347,6 +347,10 @@ enum {
   PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
   PACKETBUF_ATTR_MAC_SEQNO,
   PACKETBUF_ATTR_MAC_ACK,
+  /* The radio channel a frame was received on, and the one its sender
+     says it listens on */
+  PACKETBUF_ATTR_RX_CHANNEL,
+  PACKETBUF_ATTR_SENDER_CHANNEL,
 
   /* Scope 1 attributes: used between two neighbors only. */
   PACKETBUF_ATTR_RELIABLE,
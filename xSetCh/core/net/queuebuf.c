@@ -90,9 +90,9 @@ struct queuebuf_ref {
   uint8_t hdrlen;
 };
 
-MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
-MEMB(refbufmem, struct queuebuf_ref, QUEUEBUF_REF_NUM);
-MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
+MEMB_FREELIST(bufmem, struct queuebuf, QUEUEBUF_NUM);
+MEMB_FREELIST(refbufmem, struct queuebuf_ref, QUEUEBUF_REF_NUM);
+MEMB_FREELIST(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
 
 #if WITH_SWAP
 
@@ -117,6 +117,31 @@ get_global_addr(uip_ipaddr_t *addr)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+static int
+add_channel_option(unsigned char *buffer, int pos)
+{
+  /* Tell the neighbours which channel to reach us on */
+  buffer[pos++] = RPL_OPTION_CHANNEL;
+  buffer[pos++] = 1;
+  buffer[pos++] = uip_ds6_if.addr_list[1].currentCh;
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_neighbor_channel(uip_ipaddr_t *addr, uint8_t channel)
+{
+  uip_ds6_nbr_t *nbr;
+
+  if(channel == 0) {
+    return;
+  }
+  nbr = uip_ds6_nbr_lookup(addr);
+  if(nbr != NULL && nbr->nbrCh != channel) {
+    PRINTF("RPL: Neighbor listens on channel %u\n", channel);
+    uip_ds6_nbr_set_channel(nbr, channel);
+  }
+}
+/*---------------------------------------------------------------------------*/
 static uint32_t
 get32(uint8_t *buffer, int pos)
 {
@@ -214,8 +239,10 @@ dio_input(void)
   int len;
   uip_ipaddr_t from;
   uip_ds6_nbr_t *nbr;
+  uint8_t channel;
 
   memset(&dio, 0, sizeof(dio));
+  channel = 0;
 
   /* Set default values in case the DIO configuration option is missing. */
   dio.dag_intdoubl = RPL_DIO_INTERVAL_DOUBLINGS;
@@ -401,12 +428,23 @@ dio_input(void)
       PRINTF("RPL: Copying prefix information\n");
       memcpy(&dio.prefix_info.prefix, &buffer[i + 16], 16);
       break;
+    case RPL_OPTION_CHANNEL:
+      /* A longer option may carry a channel quality summary as well */
+      if(len < 3) {
+        PRINTF("RPL: Invalid channel option, len = %d\n", len);
+	RPL_STAT(rpl_stats.malformed_msgs++);
+        return;
+      }
+      channel = buffer[i + 2];
+      break;
     default:
       PRINTF("RPL: Unsupported suboption type in DIO: %u\n",
 	(unsigned)subopt_type);
     }
   }
 
+  set_neighbor_channel(&from, channel);
+
 #ifdef RPL_DEBUG_DIO_INPUT
   RPL_DEBUG_DIO_INPUT(&from, &dio);
 #endif
@@ -536,6 +574,8 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
            dag->prefix_info.length);
   }
 
+  pos = add_channel_option(buffer, pos);
+
 #if RPL_LEAF_ONLY
 #if (DEBUG) & DEBUG_PRINT
   if(uc_addr == NULL) {
@@ -590,8 +630,10 @@ dao_input(void)
   int i;
   int learned_from;
   rpl_parent_t *p;
+  int channel_pos;
 
   prefixlen = 0;
+  channel_pos = 0;
 
   uip_ipaddr_copy(&dao_sender_addr, &UIP_IP_BUF->srcipaddr);
 
@@ -656,9 +698,18 @@ dao_input(void)
       lifetime = buffer[i + 5];
       /* The parent address is also ignored. */
       break;
+    case RPL_OPTION_CHANNEL:
+      if(len >= 3) {
+        channel_pos = i + 2;
+      }
+      break;
     }
   }
 
+  if(channel_pos > 0) {
+    set_neighbor_channel(&dao_sender_addr, buffer[channel_pos]);
+  }
+
   PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
           (unsigned)lifetime, (unsigned)prefixlen);
   PRINT6ADDR(&prefix);
@@ -729,6 +780,11 @@ dao_input(void)
       PRINTF("RPL: Forwarding DAO to parent ");
       PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
       PRINTF("\n");
+
+      /* The parent learns the channel of the hop it hears, not ours */
+      if(channel_pos > 0) {
+        buffer[channel_pos] = uip_ds6_if.addr_list[1].currentCh;
+      }
       uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
                      ICMP6_RPL, RPL_CODE_DAO, buffer_length);
     }
@@ -827,6 +883,8 @@ dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
   buffer[pos++] = 0; /* path seq - ignored */
   buffer[pos++] = lifetime;
 
+  pos = add_channel_option(buffer, pos);
+
   PRINTF("RPL: Sending DAO with prefix ");
   PRINT6ADDR(prefix);
   PRINTF(" to ");
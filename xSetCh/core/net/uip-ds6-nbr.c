@@ -50,6 +50,7 @@
 #include "net/rime/rimeaddr.h"
 #include "net/packetbuf.h"
 #include "net/uip-ds6-nbr.h"
+#include "net/mac/nbr-channel.h"
 
 #define DEBUG DEBUG_NONE
 //#define DEBUG 1
@@ -76,6 +77,7 @@ void
 uip_ds6_neighbors_init(void)
 {
   nbr_table_register(ds6_neighbors, (nbr_table_callback *)uip_ds6_nbr_rm);
+  nbr_channel_init();
 }
 /*---------------------------------------------------------------------------*/
 uip_ds6_nbr_t *
@@ -97,7 +99,7 @@ uip_ds6_nbr_add(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr,
 
 //ADILA EDIT 14/12/14
 if(nbr->nbrCh == 0) {
-  nbr->nbrCh = 26;
+  uip_ds6_nbr_set_channel(nbr, 26);
 }
 //nbr->newCh = 26;
 //-------------------
@@ -133,6 +135,16 @@ uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr)
   return;
 }
 
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_nbr_set_channel(uip_ds6_nbr_t *nbr, uint8_t channel)
+{
+  if(nbr != NULL) {
+    nbr->nbrCh = channel;
+    /* Keep the MAC layer channel cache in step with the neighbor cache */
+    nbr_channel_set((rimeaddr_t *)uip_ds6_nbr_get_ll(nbr), channel);
+  }
+}
 /*---------------------------------------------------------------------------*/
 uip_ipaddr_t *
 uip_ds6_nbr_get_ipaddr(uip_ds6_nbr_t *nbr)
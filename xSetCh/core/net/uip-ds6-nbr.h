@@ -92,6 +92,7 @@ uip_ds6_nbr_t *uip_ds6_nbr_add(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr,
 void uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr);
 uip_lladdr_t *uip_ds6_nbr_get_ll(uip_ds6_nbr_t *nbr);
 uip_ipaddr_t *uip_ds6_nbr_get_ipaddr(uip_ds6_nbr_t *nbr);
+void uip_ds6_nbr_set_channel(uip_ds6_nbr_t *nbr, uint8_t channel);
 uip_ds6_nbr_t *uip_ds6_nbr_lookup(uip_ipaddr_t *ipaddr);
 uip_ds6_nbr_t *uip_ds6_nbr_ll_lookup(uip_lladdr_t *lladdr);
 uip_ipaddr_t *uip_ds6_nbr_ipaddr_from_lladdr(uip_lladdr_t *lladdr);
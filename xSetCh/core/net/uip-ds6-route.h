@@ -80,6 +80,17 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/* With UIP_DS6_ROUTE_CONF_INDEX, host (/128) routes are kept in a hash
+   table and the other routes on a list sorted by decreasing prefix
+   length, so that uip_ds6_route_lookup() does not scan the whole
+   routing table. Routes are then iterated in the order they were
+   added. Meant for roots with large routing tables. */
+#ifdef UIP_DS6_ROUTE_CONF_INDEX
+#define UIP_DS6_ROUTE_INDEX UIP_DS6_ROUTE_CONF_INDEX
+#else /* UIP_DS6_ROUTE_CONF_INDEX */
+#define UIP_DS6_ROUTE_INDEX 0
+#endif /* UIP_DS6_ROUTE_CONF_INDEX */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -118,6 +129,12 @@ uint8_t routeCh;
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   UIP_DS6_ROUTE_STATE_TYPE state;
 #endif
+#if UIP_DS6_ROUTE_INDEX
+  /* All routes, in the order they were added */
+  struct uip_ds6_route *index_prev, *index_next;
+  /* Next route of the sorted prefix route list */
+  struct uip_ds6_route *prefix_next;
+#endif /* UIP_DS6_ROUTE_INDEX */
   uint8_t length;
 } uip_ds6_route_t;
 
@@ -49,6 +49,8 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
+/* The list of active timers, sorted by expiration time with the timer
+   that expires first at the head. */
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
@@ -57,32 +59,82 @@ PROCESS(etimer_process, "Event timer");
 static void
 update_time(void)
 {
-  clock_time_t tdist;
-  clock_time_t now;
-  struct etimer *t;
-
   if (timerlist == NULL) {
     next_expiration = 0;
   } else {
-    now = clock_time();
-    t = timerlist;
-    /* Must calculate distance to next time into account due to wraps */
-    tdist = t->timer.start + t->timer.interval - now;
-    for(t = t->next; t != NULL; t = t->next) {
-      if(t->timer.start + t->timer.interval - now < tdist) {
-	tdist = t->timer.start + t->timer.interval - now;
-      }
+    next_expiration = timerlist->timer.start + timerlist->timer.interval;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Time left before the timer expires, or 0 if it has already expired.
+   Computed from the start time like timer_expired() so that it is safe
+   across clock wraps. */
+static clock_time_t
+time_left(struct etimer *t, clock_time_t now)
+{
+  clock_time_t passed = now - t->timer.start;
+
+  if(passed >= t->timer.interval) {
+    return 0;
+  }
+  return t->timer.interval - passed;
+}
+/*---------------------------------------------------------------------------*/
+/* Insert the timer after every timer that expires no later than it, so
+   that timers with the same expiration time fire in the order they were
+   set. The time left of all timers decreases at the same rate and stops
+   at 0, so the list stays sorted as time passes. */
+static void
+insert_timer(struct etimer *timer)
+{
+  struct etimer *t, *u;
+  clock_time_t now, left;
+
+  now = clock_time();
+  left = time_left(timer, now);
+
+  u = NULL;
+  for(t = timerlist; t != NULL && time_left(t, now) <= left; t = t->next) {
+    u = t;
+  }
+
+  timer->next = t;
+  if(u != NULL) {
+    u->next = timer;
+  } else {
+    timerlist = timer;
+  }
+
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+/* Unlink the timer from the list. Returns non-zero if it was on it. */
+static int
+remove_timer(struct etimer *timer)
+{
+  struct etimer *t;
+
+  if(timer == timerlist) {
+    timerlist = timerlist->next;
+  } else {
+    for(t = timerlist; t != NULL && t->next != timer; t = t->next);
+    if(t == NULL) {
+      return 0;
     }
-    next_expiration = now + tdist;
+    t->next = timer->next;
   }
+  timer->next = NULL;
+  update_time();
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(etimer_process, ev, data)
 {
-  struct etimer *t, *u;
+  struct etimer *t;
 	
   PROCESS_BEGIN();
 
+  process_set_priority(&etimer_process, PROCESS_PRIORITY_HIGH);
   timerlist = NULL;
   
   while(1) {
@@ -104,38 +156,29 @@ PROCESS_THREAD(etimer_process, ev, data)
 	    t = t->next;
 	}
       }
+      update_time();
       continue;
     } else if(ev != PROCESS_EVENT_POLL) {
       continue;
     }
 
-  again:
-    
-    u = NULL;
-    
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(timer_expired(&t->timer)) {
-	if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
-	  
-	  /* Reset the process ID of the event timer, to signal that the
-	     etimer has expired. This is later checked in the
-	     etimer_expired() function. */
-	  t->p = PROCESS_NONE;
-	  if(u != NULL) {
-	    u->next = t->next;
-	  } else {
-	    timerlist = t->next;
-	  }
-	  t->next = NULL;
-	  update_time();
-	  goto again;
-	} else {
-	  etimer_request_poll();
-	}
+    /* The expired timers are all at the head of the list. */
+    while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+      t = timerlist;
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) != PROCESS_ERR_OK) {
+	/* The event queue is full: try again on the next poll. */
+	etimer_request_poll();
+	break;
       }
-      u = t;
+
+      /* Reset the process ID of the event timer, to signal that the
+	 etimer has expired. This is later checked in the
+	 etimer_expired() function. */
+      t->p = PROCESS_NONE;
+      timerlist = t->next;
+      t->next = NULL;
     }
-    
+    update_time();
   }
   
   PROCESS_END();
@@ -150,27 +193,15 @@ etimer_request_poll(void)
 static void
 add_timer(struct etimer *timer)
 {
-  struct etimer *t;
-
   etimer_request_poll();
 
   if(timer->p != PROCESS_NONE) {
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(t == timer) {
-	/* Timer already on list, bail out. */
-        timer->p = PROCESS_CURRENT();
-	update_time();
-	return;
-      }
-    }
+    /* Timer may already be on the list at its old position. */
+    remove_timer(timer);
   }
 
-  /* Timer not on list. */
   timer->p = PROCESS_CURRENT();
-  timer->next = timerlist;
-  timerlist = timer;
-
-  update_time();
+  insert_timer(timer);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -198,7 +229,9 @@ void
 etimer_adjust(struct etimer *et, int timediff)
 {
   et->timer.start += timediff;
-  update_time();
+  if(et->p != PROCESS_NONE && remove_timer(et)) {
+    insert_timer(et);
+  }
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -234,26 +267,7 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
-  struct etimer *t;
-
-  /* First check if et is the first event timer on the list. */
-  if(et == timerlist) {
-    timerlist = timerlist->next;
-    update_time();
-  } else {
-    /* Else walk through the list and try to find the item before the
-       et timer. */
-    for(t = timerlist; t != NULL && t->next != et; t = t->next);
-
-    if(t != NULL) {
-      /* We've found the item before the event timer that we are about
-	 to remove. We point the items next pointer to the event after
-	 the removed item. */
-      t->next = et->next;
-
-      update_time();
-    }
-  }
+  remove_timer(et);
 
   /* Remove the next pointer from the item to be removed. */
   et->next = NULL;
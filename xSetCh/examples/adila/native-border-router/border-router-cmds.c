@@ -85,6 +85,11 @@ border_router_cmd_handler(const uint8_t *data, int len)
 	     data[2], data[3], data[4]);
       packet_sent(data[2], data[3], data[4]);
       return 1;
+    } else if(data[1] == 'B' && len >= 4 &&
+              command_context == CMD_CONTEXT_RADIO) {
+      /* The slip-radio takes '!B' batches of up to this many bytes */
+      border_router_set_slip_batch((data[2] << 8) | data[3]);
+      return 1;
     } else if(data[1] == 'D' && command_context == CMD_CONTEXT_RADIO) {
       /* We need to know that this is from the slip-radio here... */
       PRINTF("Sensor data received\n");
@@ -113,6 +118,9 @@ border_router_cmd_handler(const uint8_t *data, int len)
     } else if(data[1] == 'S') {
       border_router_print_stat();
       return 1;
+    } else if(data[1] == 'W') {
+      border_router_print_rollout();
+      return 1;
     }
   }
   return 0;
@@ -60,6 +60,20 @@
 #define MAX_CALLBACKS 16
 static int callback_pos;
 
+/* Frames sent in the same event are put into one '!B' SLIP transfer,
+   once the slip-radio has announced the size it can take */
+#ifdef BORDER_ROUTER_CONF_SLIP_BATCH
+#define SLIP_BATCH BORDER_ROUTER_CONF_SLIP_BATCH
+#else
+#define SLIP_BATCH 1
+#endif
+
+#ifdef BORDER_ROUTER_CONF_SLIP_BATCH_SIZE
+#define SLIP_BATCH_SIZE BORDER_ROUTER_CONF_SLIP_BATCH_SIZE
+#else
+#define SLIP_BATCH_SIZE 512
+#endif
+
 /* a structure for calling back when packet data is coming back
    from radio... */
 struct tx_callback {
@@ -70,6 +84,17 @@ struct tx_callback {
 };
 
 static struct tx_callback callbacks[MAX_CALLBACKS];
+
+#if SLIP_BATCH
+/* '!', 'B', then a length byte and the frame from the session id on,
+   for every batched frame */
+static uint8_t batch[SLIP_BATCH_SIZE];
+static int batch_len;
+static int batch_frames;
+static int batch_size;
+
+PROCESS(slip_batch_process, "SLIP batch process");
+#endif /* SLIP_BATCH */
 /*---------------------------------------------------------------------------*/
 void packet_sent(uint8_t sessionid, uint8_t status, uint8_t tx)
 {
@@ -102,6 +127,65 @@ setup_callback(mac_callback_t sent, void *ptr)
   return tmp;
 }
 /*---------------------------------------------------------------------------*/
+#if SLIP_BATCH
+static void
+batch_flush(void)
+{
+  if(batch_frames == 1) {
+    /* A lone frame goes as a plain send */
+    batch[1] = '!';
+    batch[2] = 'S';
+    write_to_slip(&batch[1], batch_len - 1);
+    batch[1] = 'B';
+  } else if(batch_frames > 1) {
+    write_to_slip(batch, batch_len);
+  }
+  batch_len = 2;
+  batch_frames = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+border_router_set_slip_batch(int size)
+{
+  if(size > SLIP_BATCH_SIZE) {
+    size = SLIP_BATCH_SIZE;
+  }
+  if(size != batch_size) {
+    printf("br-rdc: batching up to %d bytes over SLIP\n", size);
+    batch_flush();
+    batch_size = size;
+  }
+}
+#else /* SLIP_BATCH */
+void
+border_router_set_slip_batch(int size)
+{
+  /* Batching is compiled out; keep sending frames one by one */
+}
+#endif /* SLIP_BATCH */
+/*---------------------------------------------------------------------------*/
+/* buf holds a complete '!S' frame */
+static void
+send_frame(const uint8_t *buf, int len)
+{
+#if SLIP_BATCH
+  if(batch_frames > 0 && batch_len + 1 + len - 2 > batch_size) {
+    batch_flush();
+  }
+  if(len - 2 <= 0xff && 2 + 1 + len - 2 <= batch_size) {
+    batch[batch_len++] = len - 2;
+    memcpy(&batch[batch_len], &buf[2], len - 2);
+    batch_len += len - 2;
+    batch_frames++;
+    process_poll(&slip_batch_process);
+    return;
+  }
+  /* Too large to batch, or the radio cannot take batches */
+  batch_flush();
+#endif /* SLIP_BATCH */
+  write_to_slip(buf, len);
+}
+/*---------------------------------------------------------------------------*/
 static void
 send_packet(mac_callback_t sent, void *ptr)
 {
@@ -167,18 +251,14 @@ send_packet(mac_callback_t sent, void *ptr)
       /* if receiver MAC address is not 0000.0000.0000.0000
          it's supposed to be 0021.7402.0002.02[6]02[7] 
 	 Passing values from NT to lower layer which can't access NT (upper layers + MAC Phy)*/
-      if(((uint8_t *)packetbuf_addr(PACKETBUF_ADDR_RECEIVER))[6] != 0 && 
-	((uint8_t *)packetbuf_addr(PACKETBUF_ADDR_RECEIVER))[7] != 0) {
-	for(nbr = nbr_table_head(ds6_neighbors); nbr != NULL;
-	  nbr = nbr_table_next(ds6_neighbors,nbr)) {
-	  if((nbr->ipaddr.u8[14] == ((uint8_t *)packetbuf_addr(PACKETBUF_ADDR_RECEIVER))[6]) && 
-	    (nbr->ipaddr.u8[15] == ((uint8_t *)packetbuf_addr(PACKETBUF_ADDR_RECEIVER))[7])) {
-		buf[3] = nbr->nbrCh;
-		buf[4] = nbr->ipaddr.u8[14];
-		buf[5] = nbr->ipaddr.u8[15];
-		break;
-	  }
-	}
+      nbr = NULL;
+      if(!rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &rimeaddr_null)) {
+        nbr = uip_ds6_nbr_ll_lookup((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+      }
+      if(nbr != NULL) {
+	buf[3] = nbr->nbrCh;
+	buf[4] = nbr->ipaddr.u8[14];
+	buf[5] = nbr->ipaddr.u8[15];
       }
       else {
 	buf[3] = 0;
@@ -189,7 +269,7 @@ send_packet(mac_callback_t sent, void *ptr)
       //ADILA EDIT 01/12/15
       /* Changed default 4 to 6 */
       memcpy(&buf[6 + size], packetbuf_hdrptr(), packetbuf_totlen());
-      write_to_slip(buf, packetbuf_totlen() + size + 6);
+      send_frame(buf, packetbuf_totlen() + size + 6);
     }
   }
 }
@@ -235,6 +315,14 @@ static void
 init(void)
 {
   callback_pos = 0;
+#if SLIP_BATCH
+  batch[0] = '!';
+  batch[1] = 'B';
+  batch_len = 2;
+  batch_frames = 0;
+  batch_size = 0;
+  process_start(&slip_batch_process, NULL);
+#endif /* SLIP_BATCH */
 }
 /*---------------------------------------------------------------------------*/
 const struct rdc_driver border_router_rdc_driver = {
@@ -248,3 +336,19 @@ const struct rdc_driver border_router_rdc_driver = {
   channel_check_interval,
 };
 /*---------------------------------------------------------------------------*/
+#if SLIP_BATCH
+PROCESS_THREAD(slip_batch_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    /* Polled after the first frame of an event, so everything sent in
+       that event is in the batch when it goes out */
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    batch_flush();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+#endif /* SLIP_BATCH */
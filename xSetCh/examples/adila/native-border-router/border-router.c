@@ -50,6 +50,10 @@
 #include "cmd.h"
 #include "border-router.h"
 #include "border-router-cmds.h"
+#include "channel-colouring.h"
+#include "net/mac/spectrum-survey.h"
+#include "net/channel-msg.h"
+#include "net/channel-switch.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -78,16 +82,9 @@ static struct simple_udp_connection unicast_connection;
 //the application specific event value
 static process_event_t event_data_ready;
 
-uint8_t channelOK = 1;
 
-uint8_t noOfRoutes;
-uint8_t sendingTo = 0;
 static uip_ipaddr_t holdAddr;
 
-uint8_t noOfRetransmit;
-
-uint8_t i;
-
 struct lpbrList {
   struct lpbrList *next;
   uip_ipaddr_t routeAddr;
@@ -100,8 +97,14 @@ struct lpbrList {
   //uint8_t pktRecv;
 };
 
-LIST(lpbrList_table);
-MEMB(lpbrList_mem, struct lpbrList, 50);
+#ifdef BORDER_ROUTER_CONF_LPBR_LIST_SIZE
+#define LPBR_LIST_SIZE BORDER_ROUTER_CONF_LPBR_LIST_SIZE
+#else
+#define LPBR_LIST_SIZE 256
+#endif
+
+LIST_TAIL(lpbrList_table);
+MEMB_FREELIST(lpbrList_mem, struct lpbrList, LPBR_LIST_SIZE);
 
 struct sentRecv {
   struct sentRecv *next;
@@ -110,8 +113,8 @@ struct sentRecv {
   uint8_t noRecv;
 };
 
-LIST(sentRecv_table);
-MEMB(sentRecv_mem, struct sentRecv, 50); //for now, only sent to LPBR
+LIST_TAIL(sentRecv_table);
+MEMB_FREELIST(sentRecv_mem, struct sentRecv, 50); //for now, only sent to LPBR
 
 struct nodesTable {
   struct nodesTable *next;
@@ -122,23 +125,109 @@ struct nodesTable {
 LIST(nodesTable_table);
 MEMB(nodesTable_mem, struct nodesTable, 100);
 
+/* Latest background spectrum survey reported by each node */
+struct surveyTable {
+  struct surveyTable *next;
+  uip_ipaddr_t nodeAddr;
+  uint8_t report[SPECTRUM_SURVEY_REPORT_LEN];
+};
+
+LIST(surveyTable_table);
+MEMB(surveyTable_mem, struct surveyTable, CHANNEL_COLOURING_MAX_NODES);
+
+/* With this off the LPBR never assigns channels and every node stays on
+   the home channel, which gives the single-channel baseline that the
+   benchmarks compare against. */
+#ifdef BORDER_ROUTER_CONF_MULTICHANNEL
+#define MULTICHANNEL BORDER_ROUTER_CONF_MULTICHANNEL
+#else
+#define MULTICHANNEL 1
+#endif
+
+/* A node told to change channel with CH_SCHEDULE moves at a fixed time
+   after it, in milliseconds, and its neighbours move their entry for it
+   at the same instant. With it off, the node probes and moves with
+   CH_CHANGE as before. */
+#ifdef BORDER_ROUTER_CONF_SCHEDULED_SWITCH
+#define SCHEDULED_SWITCH BORDER_ROUTER_CONF_SCHEDULED_SWITCH
+#else
+#define SCHEDULED_SWITCH 1
+#endif
+
+#ifdef BORDER_ROUTER_CONF_SWITCH_DELAY
+#define SWITCH_DELAY BORDER_ROUTER_CONF_SWITCH_DELAY
+#else
+#define SWITCH_DELAY 8000
+#endif
+
+/* Channel changes are rolled out in waves: every node in a wave has a
+   two-hop neighbourhood disjoint from the others, and the next wave
+   starts as soon as all of them have sent CONFIRM_CH or CH_ABORT. */
+#ifdef BORDER_ROUTER_CONF_WAVE_TIMEOUT
+#define WAVE_TIMEOUT BORDER_ROUTER_CONF_WAVE_TIMEOUT
+#elif SCHEDULED_SWITCH
+#define WAVE_TIMEOUT (CHANNEL_SWITCH_TICKS(SWITCH_DELAY) + 30 * CLOCK_SECOND)
+#else
+#define WAVE_TIMEOUT (360 * CLOCK_SECOND)
+#endif
+
+#ifdef BORDER_ROUTER_CONF_WAVE_RETRIES
+#define WAVE_RETRIES BORDER_ROUTER_CONF_WAVE_RETRIES
+#else
+#define WAVE_RETRIES 2
+#endif
+
+/* CH_REQUESTs re-run the channel assignment at most this often. The
+   requests that arrive in between are recorded and handled together
+   when the hold-off ends. */
+#ifdef BORDER_ROUTER_CONF_RECOLOUR_HOLDOFF
+#define RECOLOUR_HOLDOFF BORDER_ROUTER_CONF_RECOLOUR_HOLDOFF
+#else
+#define RECOLOUR_HOLDOFF (60 * CLOCK_SECOND)
+#endif
+
 enum {
-	CH_CHANGE,
-	NBR_CH_CHANGE,
-	STARTPROBE,
-	NBRPROBE,
-	PROBERESULT,
-	CONFIRM_CH,
-	GET_ACK,
-	SENTRECV,
-	SEND_NBR,
-	SEND_CH
+  ROLLOUT_PENDING,
+  ROLLOUT_SENT,
+  ROLLOUT_CONFIRMED,
+  ROLLOUT_FAILED
+};
+
+struct rollout {
+  struct rollout *next;
+  uip_ipaddr_t addr;
+  uint8_t channel;
+  uint8_t state;
+  uint8_t wave;
+  uint8_t retries;
 };
 
+LIST_TAIL(rollout_table);
+MEMB_FREELIST(rollout_mem, struct rollout, CHANNEL_COLOURING_MAX_NODES);
+
+static struct {
+  uint8_t running;
+  uint8_t wave;
+  uint8_t waveSize;
+  uint8_t waveConfirmed;
+  uint8_t waveAborted;
+  uint16_t nodes;
+  uint16_t confirmed;
+  uint16_t aborted;
+  uint16_t failed;
+  uint16_t resent;
+  uint8_t largestWave;
+  clock_time_t started;
+  clock_time_t waveStarted;
+  clock_time_t longestWave;
+  clock_time_t duration;
+} rollout;
+
 struct unicast_message {
 	uint8_t type;
 	uint8_t value;
 	uint8_t value2;
+	uint16_t time;
 
 	uip_ipaddr_t address;
 	uip_ipaddr_t *addrPtr; 
@@ -205,375 +294,309 @@ static int blen;
     blen += snprintf(&buf[blen], sizeof(buf) - blen, __VA_ARGS__);      \
   } while(0)
 /*---------------------------------------------------------------------------*/
-uint8_t lpbrCheck2ndHop(const uip_ipaddr_t *toSendAddr, uint8_t chCheck) {
+/* Rebuild the two-hop conflict graph from everything the LPBR has
+   learned and colour it in one pass. */
+static void
+buildChannelAssignment(void)
+{
+  struct lpbrList *l;
+  struct nodesTable *nt;
+  struct surveyTable *st;
+  static uip_ds6_route_t *r;
   static uip_ds6_nbr_t *nbr;
+  uip_ds6_addr_t *lladdr;
+  int unresolved;
 
-  //check with all LPBR neighbours
-  for(nbr = nbr_table_head(ds6_neighbors); nbr != NULL;
-    nbr = nbr_table_next(ds6_neighbors,nbr)) {
-    if(toSendAddr->u8[13] != nbr->ipaddr.u8[13]) {
-      if((nbr->nbrCh) != chCheck) {
-	channelOK = 1;
-	//printf("LPBR2hopsLPBR ch %d lchNum %d l %d to %d\n\n", chCheck, nbr->nbrCh, nbr->ipaddr.u8[13], toSendAddr->u8[13]);
-        //!chCheck = random_rand();
-      }//END ((nbr->nbrCh) != chCheck)
-      else {
-	channelOK = 0;
-	//printf("CHECK CH: 2HOPSLPBR 2 HOP FAILED\n\n");
-        //printf("2hopsLPBR %d\n\n", channelOK);
-        break;
-       //return NOT OK
-      }
-    }//END IF 
-  }//END FOR
-  return channelOK;
-}
-/*---------------------------------------------------------------------------*/
-uint8_t secondCheck(const uip_ipaddr_t *toSendAddr, uint8_t chCheck) {
-  struct lpbrList *l;
+  channel_colouring_reset();
 
-  for(l = list_head(lpbrList_table); l != NULL; l = l->next) {
-    if(l->nbrAddr.u8[13] == toSendAddr->u8[13]) {
-      if(l->chNum != chCheck) {
-	//printf("2hopsothernodes %d ch %d lchNum %d l %d to %d\n\n", l->routeAddr.u8[13], chCheck, l->chNum, l->nbrAddr.u8[13], toSendAddr->u8[13]);
-	//printf("l->chNum %d != chCheck %d\n\n", l->chNum, chCheck);
-	channelOK = 1;
-      }
-      else {
-	channelOK = 0;
-	//printf("CHECK CH: SECONDCHECK FAILED!\n\n");
-	break;
-      }
+  lladdr = uip_ds6_get_link_local(-1);
+  if(lladdr != NULL) {
+    channel_colouring_add_fixed(&lladdr->ipaddr,
+                                uip_ds6_if.addr_list[1].currentCh);
+  }
+
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    channel_colouring_add_node(&r->ipaddr, r->routeCh);
+  }
+
+  for(nbr = nbr_table_head(ds6_neighbors); nbr != NULL;
+    nbr = nbr_table_next(ds6_neighbors, nbr)) {
+    channel_colouring_add_node(&nbr->ipaddr, nbr->nbrCh);
+    if(lladdr != NULL) {
+      channel_colouring_add_link(&lladdr->ipaddr, &nbr->ipaddr);
     }
   }
-  return channelOK;  
-  //return chCheck;
-}
-/*---------------------------------------------------------------------------*/
-uint8_t twoHopsOtherNodes(const uip_ipaddr_t *toSendAddr, uint8_t chCheck) {
-  struct lpbrList *l;
-  uint8_t tempVal;
 
-  static uip_ds6_nbr_t *nbr;
-  static uip_ds6_route_t *r;
+  for(nt = list_head(nodesTable_table); nt != NULL; nt = nt->next) {
+    channel_colouring_add_link(&nt->nodeAddr, &nt->nodeNbr);
+  }
 
-  //for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
   for(l = list_head(lpbrList_table); l != NULL; l = l->next) {
-    if(l->nbrAddr.u8[13] == toSendAddr->u8[13]) {
-      //printf("1hopsothernodes %d ch %d lchNum %d l %d to %d\n\n", l->routeAddr.u8[13], chCheck, l->chNum, l->nbrAddr.u8[13], toSendAddr->u8[13]);
-      if(l->chNum != chCheck) {
-	//printf("l->chNum %d != chCheck %d\n\n", l->chNum, chCheck);
-	//tempVal = l->routeAddr.u8[13];
-
-	for(nbr = nbr_table_head(ds6_neighbors); nbr != NULL;
-	  nbr = nbr_table_next(ds6_neighbors,nbr)) {
-	    if(l->routeAddr.u8[13] == nbr->ipaddr.u8[13]) {
-	      if(uip_ds6_if.addr_list[1].currentCh != chCheck) {
-	        //printf("2nd hop is LPBR %d chCheck %d\n\n", uip_ds6_if.addr_list[1].currentCh, chCheck);
-	        channelOK = 1;
-	      }
-	      else {
-		channelOK = 0;
-		//printf("CHECK CH: 2HOPSOTHERNODES 2 HOP LPBR FAILED for %d\n\n", l->routeAddr.u8[13]);
-		break;
-	      }
-	    }
-  	}
-	channelOK = secondCheck(&l->routeAddr, chCheck);
-	if(channelOK == 0) {
-	  break;
-	}
-      }
-      else {
-        channelOK = 0;
-	//printf("CHECK CH: 2HOPSOTHERNODES 1 HOP FAILED\n\n");
-	break;
-      }
-    }//END IF 1ST HOP
-  }//END FOR 1ST FOR
+    channel_colouring_add_link(&l->routeAddr, &l->nbrAddr);
+    channel_colouring_add_quality(&l->routeAddr, l->chNum, l->rxValue);
+  }
+
+  for(st = list_head(surveyTable_table); st != NULL; st = st->next) {
+    channel_colouring_add_survey(&st->nodeAddr, st->report);
+  }
 
-  return channelOK;
-  //return chCheck;
+  unresolved = channel_colouring_run();
+  channel_colouring_print();
+  if(unresolved > 0) {
+    printf("%d NODES SHARE A CHANNEL WITHIN 2 HOPS\n", unresolved);
+  }
 }
 /*---------------------------------------------------------------------------*/
-uint8_t twoHopsLPBR(const uip_ipaddr_t *toSendAddr, uint8_t chCheck) {
-  static uip_ds6_nbr_t *nbr;
-
-  for(nbr = nbr_table_head(ds6_neighbors); nbr != NULL;
-    nbr = nbr_table_next(ds6_neighbors,nbr)) {
-    if(toSendAddr->u8[13] == nbr->ipaddr.u8[13]) {
-      //check LPBR != chCheck (1 hop)
-      if(uip_ds6_if.addr_list[1].currentCh != chCheck) {
-	//printf("LPBR1hopsLPBR ch %d lchNum %d l %d to %d\n\n", chCheck, uip_ds6_if.addr_list[1].currentCh, nbr->ipaddr.u8[13], toSendAddr->u8[13]);
-
-        channelOK = lpbrCheck2ndHop(toSendAddr, chCheck);
-        if(channelOK == 0) {
-	  break;
-	}
-      }//END IF
-      else {
-	channelOK = 0;
-	//printf("CHECK CH: 2HOPSOTHERNODES 1 HOP FAILED\n\n");
-	break;
-        //return NOT OK (same CH as LPBR)
-      }
-    }//END IF toSendAddr == nbr->ipaddr
-  }//END FOR
-
-  return channelOK;
-  //return chCheck;
+/* The neighbour is found from the interface identifier of its
+   address, so the whole link-layer address has to match */
+static void ipToLladdr(const uip_ipaddr_t *addr, uip_lladdr_t *lladdr) {
+  memcpy(lladdr, &addr->u8[8], UIP_LLADDR_LEN);
+  lladdr->addr[0] ^= 0x02;
+}
+/*---------------------------------------------------------------------------*/
+/* Control messages go on air in the compact encoding of channel-msg */
+static void sendMsg(const struct unicast_message *msg, const uip_ipaddr_t *to) {
+  struct channel_msg out;
+  uint8_t buf[CHANNEL_MSG_MAX_LEN];
+  int len;
+
+  out.type = msg->type;
+  out.value = msg->value;
+  out.value2 = msg->value2;
+  out.time = msg->time;
+  uip_ipaddr_copy(&out.address, &msg->address);
+  out.survey_len = 0;
+
+  len = channel_msg_encode(buf, sizeof(buf), &out);
+  if(len > 0) {
+    simple_udp_sendto(&unicast_connection, buf, len, to);
+  }
 }
 /*---------------------------------------------------------------------------*/
 void doSending(struct unicast_message *msg) {
-  //struct unicast_message *msg;
   struct unicast_message msg2;
+  uint8_t newCh;
 
-  uint8_t randomNewCh;
-  static uip_ds6_route_t *r;
-
-  static uip_ds6_nbr_t *nbr;
-  static uip_ds6_route_t *re;
-
-uint8_t randomValue;
-uint8_t rv;
-
-randomValue = (random_rand() % 10) + 1;
-
-  //printf("GOT FROM STARTCHCHANGE WHEN 0 ");
-  //uip_debug_ipaddr_print(&msg->address);
-  //printf("\n\n");
   uip_ipaddr_copy(&holdAddr, &msg->address);
 
-//random_init((random_rand() % 6) + 20);
-//random_init(16);
-  //!!randomNewCh = (random_rand() % 16) + 11;
-
-randomNewCh = (random_rand() % 16) + 11;
-
-/*printf("RV %d\n\n", rv);
-while(rv < randomValue) {
-  randomNewCh = (random_rand() % 6) + 20;
-
-  rv++;
-}*/
-  //! check if randomNewCh is blacklisted (if it's on the list, low success rate)
-
-  msg2.type = CH_CHANGE;
-  msg2.value = randomNewCh;
-  //msg2.address = r->ipaddr;
-  msg2.address = msg->address;
-//  msg2.paddingBuf[30] = " ";
-
-  channelOK = twoHopsLPBR(&msg2.address, msg2.value);
-  channelOK = twoHopsOtherNodes(&msg2.address, msg2.value);
-
-  //channel will be selected and checked with 2 hops for 4 times
-  //if failed, it will use the default channel, 26
-  while(channelOK == 0 && i < 4) {
-    //!!randomNewCh = (random_rand() % 16) + 11;
-  randomNewCh = (random_rand() % 6) + 20;
-    while(msg2.value == randomNewCh) {
-      //!!randomNewCh = (random_rand() % 16) + 11;
-  randomNewCh = (random_rand() % 6) + 20;
-      //printf("RANDOMNEWCH %d i %d\n\n", randomNewCh, i);
-    }
-    channelOK = twoHopsLPBR(&msg2.address, randomNewCh);
-    channelOK = twoHopsOtherNodes(&msg2.address, randomNewCh);
-
-    i++;
+  newCh = channel_colouring_get(&msg->address);
+  if(newCh == CHANNEL_COLOURING_NONE) {
+    //node joined after the last colouring
+    buildChannelAssignment();
+    newCh = channel_colouring_get(&msg->address);
   }
-
-  if(i == 4) {
-    //couldn't find a 2 hops channel value, use the default 26
-    //printf("%d RANDOMNEWCH USE DEFAULT\n\n", i);
-    randomNewCh = 26;
-    i = 0;
-  }
-
-  while(channelOK == 0) {
-    //!!randomNewCh = (random_rand() % 16) + 11;
-  randomNewCh = (random_rand() % 6) + 20;
-    while(msg2.value == randomNewCh) {
-      //!!randomNewCh = (random_rand() % 16) + 11;
-  randomNewCh = (random_rand() % 6) + 20;
-    }
-    channelOK = twoHopsLPBR(&msg2.address, randomNewCh);
-    channelOK = twoHopsOtherNodes(&msg2.address, randomNewCh);
+  if(newCh == CHANNEL_COLOURING_NONE) {
+    //graph is full, use the default 26
+    newCh = 26;
   }
 
-  //printf("LPBR2 CHANNEL OK? %d\n\n\n", channelOK);
-  msg2.value = randomNewCh;
-
-//msg2.value = 22;
-msg2.value = 26;
+#if SCHEDULED_SWITCH
+  msg2.type = CH_SCHEDULE;
+  msg2.time = SWITCH_DELAY;
+#else
+  msg2.type = CH_CHANGE;
+#endif
+  msg2.value = newCh;
+  msg2.address = msg->address;
 
   printf("%d: %d BR Sending channel to change for ", sizeof(msg2), msg2.value);
   uip_debug_ipaddr_print(&msg2.address);
-  //printf(" via ");
-  //uip_debug_ipaddr_print(uip_ds6_route_nexthop(r));
-//uip_debug_ipaddr_print(&msg2.addrPtr);
   printf("\n");
 
-  simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2) + 1, &msg2.address);
-  process_post(&chChange_process, event_data_ready, NULL);
+  sendMsg(&msg2, &msg2.address);
 }
 /*---------------------------------------------------------------------------*/
-static void startChChange(uint8_t currentNode) {
-  struct unicast_message msg2;
+/* Queue a CH_CHANGE for every route whose assigned channel differs from
+   the one it is on, then let chChange_process run the waves. */
+static void
+rolloutStart(void)
+{
+  struct rollout *ro;
   static uip_ds6_route_t *r;
+  uint8_t newCh;
 
-  uint8_t i = 0;
-
-  for(r = uip_ds6_route_head(); r != NULL; 
-    r = uip_ds6_route_next(r)) {
-    i++;
-    if(i == currentNode) {
-      msg2.address = r->ipaddr;
-//msg2.addrPtr = uip_ds6_route_nexthop(r);
-//uip_ipaddr_copy(msg2.addrPtr, uip_ds6_route_nexthop(r));
-      //printf("i %d currentNode %d ", i, currentNode);
-      //uip_debug_ipaddr_print(&r->ipaddr);
-      //printf("\n\n");
-      doSending(&msg2);
-      break;
-    }
+  if(!MULTICHANNEL) {
+    return;
   }
-}
-/*---------------------------------------------------------------------------*/
-static void howManyRoutes() {
-  static uip_ds6_route_t *r;
-
-  for(r = uip_ds6_route_head(); r != NULL; 
-    r = uip_ds6_route_next(r)) {
 
-    noOfRoutes = noOfRoutes + 1;
-
-//printf("1:%x 2:%x 3:%x 4:%x 5:%x 6:%x 7:%x 8:%x 9:%x 10:%x 11:%x 12:%x 13:%x 14:%x 15:%x\n", r->ipaddr.u8[1], r->ipaddr.u8[2], r->ipaddr.u8[3], r->ipaddr.u8[4], r->ipaddr.u8[5], r->ipaddr.u8[6], r->ipaddr.u8[7], r->ipaddr.u8[8], r->ipaddr.u8[9], r->ipaddr.u8[10], r->ipaddr.u8[11], r->ipaddr.u8[12], r->ipaddr.u8[13], r->ipaddr.u8[14], r->ipaddr.u8[15]);
-    //printf("%d NO OF ROUTE ", noOfRoutes);
-    //uip_debug_ipaddr_print(&r->ipaddr);
-    //printf("\n");
+  if(rollout.running) {
+    printf("ROLLOUT ALREADY RUNNING, WAVE %d\n", rollout.wave);
+    return;
   }
-}
-/*---------------------------------------------------------------------------*/
-static void recheck2() {
-  struct lpbrList *l;
-  static uip_ds6_route_t *r;
-  uint8_t checkOK = 0;
-  uip_ipaddr_t theMissedAddr;
 
-  struct unicast_message msg2;
+  while((ro = list_tail_pop(rollout_table)) != NULL) {
+    memb_free(&rollout_mem, ro);
+  }
+  memset(&rollout, 0, sizeof(rollout));
 
   for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
-    for(l = list_head(lpbrList_table); l != NULL; l = l->next) {
-      if(uip_ipaddr_cmp(&r->ipaddr, &l->routeAddr)) {
-        /*printf("SAME ");
-	uip_debug_ipaddr_print(&r->ipaddr);
-	printf(" ");
-	uip_debug_ipaddr_print(&l->routeAddr);
-	printf("\n");*/
-	checkOK = 1;
-	break;
-      }
-      else {
-	checkOK = 0;
-      }
+    newCh = channel_colouring_get(&r->ipaddr);
+    if(newCh == CHANNEL_COLOURING_NONE || newCh == r->routeCh) {
+      continue;
     }
-    if(checkOK == 0) {
-      uip_ipaddr_copy(&theMissedAddr, &r->ipaddr);
-      printf("themissedaddr ");
-      uip_debug_ipaddr_print(&theMissedAddr);
-      printf("\n\n");
-      //break;
-      msg2.address = theMissedAddr;
-      //process_post_synch(&test, event_data_ready, &msg2);
-      //doSending(&msg2);
+    ro = memb_alloc(&rollout_mem);
+    if(ro == NULL) {
+      break;
     }
+    uip_ipaddr_copy(&ro->addr, &r->ipaddr);
+    ro->channel = newCh;
+    ro->state = ROLLOUT_PENDING;
+    ro->wave = 0;
+    ro->retries = 0;
+    list_tail_add(rollout_table, ro);
+    rollout.nodes++;
   }
- 
-/*  if(checkOK == 0) {
-    printf("recheck2 checkOK %d ", checkOK);
-    uip_debug_ipaddr_print(&theMissedAddr);
-    printf("\n");
+
+  if(rollout.nodes > 0) {
+    rollout.running = 1;
+    rollout.started = clock_time();
+    process_post(&chChange_process, event_data_ready, NULL);
   }
-*/
 }
+/*---------------------------------------------------------------------------*/
+/* Send CH_CHANGE to every pending node that is independent of the nodes
+   already in this wave. Returns the size of the wave. */
+static uint8_t
+rolloutNextWave(void)
+{
+  struct rollout *ro, *other;
+  struct unicast_message msg2;
 
-/*uint8_t waitingTime(const uip_ipaddr_t *ipAddress) {
-  struct lpbrList *l;
-  uint8_t checkOK = 0;
+  rollout.wave++;
+  rollout.waveSize = 0;
+  rollout.waveConfirmed = 0;
+  rollout.waveAborted = 0;
+  rollout.waveStarted = clock_time();
 
-  for(l = list_head(lpbrList_table); l != NULL; l = l->next) {
-    if(uip_ipaddr_cmp(&l->routeAddr, ipAddress)) {
-      printf("CALL NEXT ROUTE FOR CH_CHANGE\n\n");
-      checkOK = 1;
-      break;
+  for(ro = list_head(rollout_table); ro != NULL; ro = ro->next) {
+    if(ro->state != ROLLOUT_PENDING) {
+      continue;
     }
-    else {
-      checkOK = 0;
+    for(other = list_head(rollout_table); other != NULL; other = other->next) {
+      if(other->state == ROLLOUT_SENT &&
+         !channel_colouring_independent(&ro->addr, &other->addr)) {
+        break;
+      }
+    }
+    if(other != NULL) {
+      continue;
     }
+    if(ro->retries > 0) {
+      rollout.resent++;
+    }
+    ro->state = ROLLOUT_SENT;
+    ro->wave = rollout.wave;
+    rollout.waveSize++;
+    msg2.address = ro->addr;
+    doSending(&msg2);
   }
 
-  if(checkOK == 0) {
-    printf("NEED MORE TIME\n\n");
-    return checkOK;
+  if(rollout.waveSize > rollout.largestWave) {
+    rollout.largestWave = rollout.waveSize;
   }
-  else {
-    printf("CAN PROCEES TO NEXT CH_CHANGE\n\n");
-    return checkOK;
+  return rollout.waveSize;
+}
+/*---------------------------------------------------------------------------*/
+/* Nodes of the wave that did not confirm are retried in a later wave. */
+static void
+rolloutEndWave(void)
+{
+  struct rollout *ro;
+  clock_time_t waveTime;
+
+  for(ro = list_head(rollout_table); ro != NULL; ro = ro->next) {
+    if(ro->state == ROLLOUT_SENT) {
+      ro->retries++;
+      if(ro->retries > WAVE_RETRIES) {
+        ro->state = ROLLOUT_FAILED;
+        rollout.failed++;
+      } else {
+        ro->state = ROLLOUT_PENDING;
+      }
+    }
   }
-}*/
-
-static void recheck(const uip_ipaddr_t *ipAddress) {
-//static void recheck() {
-  struct lpbrList *l;
-  //static uip_ds6_route_t *r;
-  uint8_t checkOK = 0;
-  //uip_ipaddr_t *theMissedAddr;
 
-    sendingTo = sendingTo + 1;
-    //noOfRetransmit = 0;
-    startChChange(sendingTo);
-
-  for(l = list_head(lpbrList_table); l != NULL; l = l->next) {
-    if(uip_ipaddr_cmp(&l->routeAddr, ipAddress)) {
-      //printf("SAME ");
-      //uip_debug_ipaddr_print(ipAddress);
-      //printf(" ");
-      //uip_debug_ipaddr_print(&l->routeAddr);
-      //printf("\n");
-      checkOK = 1;
-      break;
-    }
-    else {
-      checkOK = 0;
+  waveTime = clock_time() - rollout.waveStarted;
+  if(waveTime > rollout.longestWave) {
+    rollout.longestWave = waveTime;
+  }
+  printf("WAVE %d DONE: %d/%d CONFIRMED, %d ABORTED IN %lu s, %d/%d NODES\n",
+         rollout.wave, rollout.waveConfirmed, rollout.waveSize,
+         rollout.waveAborted,
+         (unsigned long)(waveTime / CLOCK_SECOND),
+         rollout.confirmed + rollout.failed, rollout.nodes);
+}
+/*---------------------------------------------------------------------------*/
+/* A confirmation can arrive after its wave timed out and the node was
+   queued for a retry, or even marked failed. The node has switched all
+   the same, so it is not sent CH_CHANGE again. */
+static void
+rolloutConfirm(const uip_ipaddr_t *senderAddr)
+{
+  struct rollout *ro;
+
+  for(ro = list_head(rollout_table); ro != NULL; ro = ro->next) {
+    if(ro->state != ROLLOUT_CONFIRMED &&
+       memcmp(&ro->addr.u8[8], &senderAddr->u8[8], 8) == 0) {
+      if(ro->state == ROLLOUT_SENT) {
+        rollout.waveConfirmed++;
+      } else if(ro->state == ROLLOUT_FAILED) {
+        rollout.failed--;
+      }
+      ro->state = ROLLOUT_CONFIRMED;
+      rollout.confirmed++;
+      process_post(&chChange_process, event_data_ready, NULL);
+      return;
     }
   }
-
-  //if(checkOK == 1) {
-  if(checkOK == 1 || noOfRetransmit == 4) {
-    //printf("NOOFRETRANSMIT %d\n\n", noOfRetransmit);
-    sendingTo = sendingTo + 1;
-    noOfRetransmit = 0;
-    //printf("CHANNELOK 1 SENDING TO %d\n\n", sendingTo);
-    startChChange(sendingTo);
-
-    //!!!!! if sending done recheck the whole table again?
-    if(sendingTo == (noOfRoutes + 1)) {
-      //recheck again
-      //printf("SENDINGTO-1 %d NOOFROUTES %d\n\n", sendingTo, noOfRoutes + 1);
-      recheck2();
+}
+/*---------------------------------------------------------------------------*/
+/* The node rolled its switch back because too few neighbours acked it,
+   which answers the wave like a lost confirmation would have. */
+static void
+rolloutAbort(const uip_ipaddr_t *senderAddr)
+{
+  struct rollout *ro;
+
+  for(ro = list_head(rollout_table); ro != NULL; ro = ro->next) {
+    if(ro->state == ROLLOUT_SENT &&
+       memcmp(&ro->addr.u8[8], &senderAddr->u8[8], 8) == 0) {
+      ro->retries++;
+      if(ro->retries > WAVE_RETRIES) {
+        ro->state = ROLLOUT_FAILED;
+        rollout.failed++;
+      } else {
+        ro->state = ROLLOUT_PENDING;
+      }
+      rollout.aborted++;
+      rollout.waveAborted++;
+      process_post(&chChange_process, event_data_ready, NULL);
+      return;
     }
-
   }
-  else {
-    //repeat sending to the same node
-    //startChChange(sendingTo);
-    printf("NOOFRETRANSMIT %d\n\n", noOfRetransmit);
-    //printf("CHANNELOK 0 SENDING TO %d\n\n", sendingTo);
-    noOfRetransmit = noOfRetransmit + 1;
-    startChChange(sendingTo);
+}
+/*---------------------------------------------------------------------------*/
+void
+border_router_print_rollout(void)
+{
+  struct rollout *ro;
+  static const char *states[] = { "PENDING", "SENT", "CONFIRMED", "FAILED" };
+
+  printf("ROLLOUT %s: wave %d, %d/%d confirmed, %d failed, %d resent, "
+         "%d aborted\n",
+         rollout.running ? "RUNNING" : "IDLE", rollout.wave,
+         rollout.confirmed, rollout.nodes, rollout.failed, rollout.resent,
+         rollout.aborted);
+  printf("largest wave %d, longest wave %lu s, total %lu s\n",
+         rollout.largestWave,
+         (unsigned long)(rollout.longestWave / CLOCK_SECOND),
+         (unsigned long)((rollout.running ?
+                          clock_time() - rollout.started :
+                          rollout.duration) / CLOCK_SECOND));
+  for(ro = list_head(rollout_table); ro != NULL; ro = ro->next) {
+    uip_debug_ipaddr_print(&ro->addr);
+    printf("\tch %d wave %d %s\n", ro->channel, ro->wave, states[ro->state]);
   }
-
 }
 /*---------------------------------------------------------------------------*/
 static void readProbe(uint8_t checkValue) {
@@ -622,7 +645,7 @@ static void keepLpbrList(const uip_ipaddr_t *senderAddr, uip_ipaddr_t nbrAddr, u
     uip_ipaddr_copy(&l->nbrAddr, &nbrAddr);
     l->chNum = chValue;
     l->rxValue = pktRecv;
-    list_add(lpbrList_table, l);
+    list_tail_add(lpbrList_table, l);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -653,7 +676,7 @@ static void keepSentRecv(const uip_ipaddr_t *sendToAddr, uint8_t pktSent, uint8_
     sr->noSent = pktSent;
     sr->noRecv = pktRecv;
     uip_ipaddr_copy(&sr->sendToAddr, sendToAddr);
-    list_add(sentRecv_table, sr);
+    list_tail_add(sentRecv_table, sr);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -674,31 +697,53 @@ static void set_nodes_table(const uip_ipaddr_t *nodeAddr, const uip_ipaddr_t nod
   }
 }
 /*---------------------------------------------------------------------------*/
-/*static void recheckChChange(struct unicast_message *msg) {
-  struct sentRecv *sr; 
-  struct unicast_message msg2;
+static void keepSurvey(const uip_ipaddr_t *nodeAddr, const uint8_t *report) {
+  struct surveyTable *st;
 
-  printf("RECHECK VALUE SENT %d ", msg->value);
-  uip_debug_ipaddr_print(msg->addrPtr);
-  printf("\n\n");
-  for(sr = list_head(sentRecv_table); sr != NULL; sr = sr->next) {
-    if(uip_ipaddr_cmp(msg->addrPtr, &sr->sendToAddr)) {
-      printf("keepSentRecv SAME s: %d r: %d ", msg->value, sr->noRecv);
-      uip_debug_ipaddr_print(&sr->sendToAddr);
-      printf("\n");
+  for(st = list_head(surveyTable_table); st != NULL; st = st->next) {
+    if(uip_ipaddr_cmp(nodeAddr, &st->nodeAddr)) {
+      break;
+    }
+  }
 
-      //if(msg->value == sr->noRecv) {
-      if(msg->value != sr->noRecv) {
-	sr->noRecv = 0;
-	msg2.address = sr->sendToAddr;
-	doSending(&msg2);
-      }
+  if(st == NULL) {
+    st = memb_alloc(&surveyTable_mem);
+    if(st == NULL) {
+      return;
     }
+    uip_ipaddr_copy(&st->nodeAddr, nodeAddr);
+    list_add(surveyTable_table, st);
   }
+  memcpy(st->report, report, SPECTRUM_SURVEY_REPORT_LEN);
+}
+/*---------------------------------------------------------------------------*/
+static struct timer recolourHoldoff;
+static struct ctimer recolourTimer;
+static uint8_t recolourPending;
 
-  //doSending(&msg2);
+static void
+recolour(void *ptr)
+{
+  recolourPending = 0;
+  timer_set(&recolourHoldoff, RECOLOUR_HOLDOFF);
+  buildChannelAssignment();
+  rolloutStart();
+}
+/*---------------------------------------------------------------------------*/
+static void
+requestRecolour(void)
+{
+  if(recolourPending) {
+    return;
+  }
+  if(recolourHoldoff.interval == 0 || timer_expired(&recolourHoldoff)) {
+    recolour(NULL);
+  } else {
+    recolourPending = 1;
+    ctimer_set(&recolourTimer, timer_remaining(&recolourHoldoff),
+               recolour, NULL);
+  }
 }
-*/
 /*---------------------------------------------------------------------------*/
 static void
 receiver(struct simple_udp_connection *c,
@@ -709,16 +754,21 @@ receiver(struct simple_udp_connection *c,
          const uint8_t *data,
          uint16_t datalen)
 {
-  struct unicast_message *msg;
-  msg = data;
+  struct channel_msg in;
+  const struct channel_msg *msg;
 
   static uip_ds6_route_t *r;
   static uip_ds6_nbr_t *nbr;
+  uip_lladdr_t lladdr;
 
   struct unicast_message msg2;
 
   struct lpbrList *l;
 
+  //anything that is not a control message falls through to the data case
+  channel_msg_decode(&in, data, datalen);
+  msg = &in;
+
   if(msg->type == PROBERESULT) {
     printf("LPBR RECEIVED PROBERESULT: from ");
     uip_debug_ipaddr_print(sender_addr);
@@ -734,18 +784,28 @@ receiver(struct simple_udp_connection *c,
 
 //21 may
     msg2.type = PROBERESULT;
+    msg2.value = 0;
+    msg2.value2 = 0;
     msg2.address = msg->address;
     //msg2.value2 = 1;
 
-    simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2) + 1, sender_addr);
+    sendMsg(&msg2, sender_addr);
     
   }
 
+  else if(msg->type == SURVEY) {
+    if(msg->survey_len == SPECTRUM_SURVEY_REPORT_LEN) {
+      keepSurvey(sender_addr, msg->survey);
+    }
+  }
+
   else if(msg->type == CONFIRM_CH) {
     printf("CONFIRM CH Received %d from ", msg->value);
     uip_debug_ipaddr_print(sender_addr);
     printf("\n\n");
 
+    rolloutConfirm(sender_addr);
+
     for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
       if(sender_addr->u8[13] == r->ipaddr.u8[13]) {
       //if(uip_ipaddr_cmp(sender_addr, &r->ipaddr)) {
@@ -759,16 +819,8 @@ receiver(struct simple_udp_connection *c,
     }
 
     //! updates LPBR RT
-    for(nbr = nbr_table_head(ds6_neighbors); nbr != NULL;
-      nbr = nbr_table_next(ds6_neighbors,nbr)) {
-      if(sender_addr->u8[13] == nbr->ipaddr.u8[13]) {
-        nbr->nbrCh = msg->value;
-        //printf("UPDATE NBR TABLE: ");
-        //uip_debug_ipaddr_print(&nbr->ipaddr);
-        //printf(" nbr->nbrCh %d ", nbr->nbrCh);
-        //printf("\n");
-      }
-    }
+    ipToLladdr(sender_addr, &lladdr);
+    uip_ds6_nbr_set_channel(uip_ds6_nbr_ll_lookup(&lladdr), msg->value);
 
     /*for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
       printf("RT: ");
@@ -785,20 +837,6 @@ receiver(struct simple_udp_connection *c,
     }*/
   }
 
-/*  else if(msg->type == SENTRECV) {
-    printf("Received SENTRECV %d from ", msg->value);
-    uip_debug_ipaddr_print(sender_addr);
-    printf("\n");
-
-    msg2.value = msg->value;
-    uip_ipaddr_copy(&msg2.addrPtr, &sender_addr);
-
-    /*if(sender_addr->u8[11] == 2) {
-      recheckChChange(&msg2);
-    }*/
-//    recheckChChange(&msg2);
-
-//  }
 else if(msg->type == SEND_NBR) {
 printf("MSG SEND_NBR FROM ");
 uip_debug_ipaddr_print(sender_addr);
@@ -813,6 +851,42 @@ else if(msg->type == SEND_CH) {
 //printf("R SEND CH %d\n\n", msg->value);
 }
 
+  else if(msg->type == NBR_CH_SCHEDULE) {
+    //a neighbour of the LPBR is moving, keep our entry for it in step;
+    //if we cannot, it must not count on us
+    if(channel_switch_nbr(sender_addr, msg->value,
+                          CHANNEL_SWITCH_TICKS(msg->time))) {
+      msg2.type = SCHEDULE_ACK;
+    }
+    else {
+      msg2.type = SCHEDULE_NACK;
+    }
+    msg2.value = msg->value;
+    sendMsg(&msg2, sender_addr);
+  }
+
+  else if(msg->type == CH_ABORT) {
+    printf("R CH ABORT %d from ", msg->value);
+    uip_debug_ipaddr_print(sender_addr);
+    printf("\n");
+
+    channel_switch_nbr_cancel(sender_addr);
+    rolloutAbort(sender_addr);
+  }
+
+  else if(msg->type == CH_REQUEST) {
+    printf("R CH REQUEST %d (%d%% acked) for ", msg->value, msg->value2);
+    uip_debug_ipaddr_print(&msg->address);
+    printf(" from ");
+    uip_debug_ipaddr_print(sender_addr);
+    printf("\n");
+
+    //the retransmission table of the sender saw its link into msg->address
+    //degrade: record the channel as unusable there and reassign
+    keepLpbrList(&msg->address, *sender_addr, msg->value, 0);
+    requestRecolour();
+  }
+
   else {
     printf("Data received from ");
     uip_debug_ipaddr_print(sender_addr);
@@ -959,6 +1033,8 @@ static void
 request_mac(void)
 {
   write_to_slip((uint8_t *)"?M", 2);
+  /* A slip-radio that batches answers with its batch size */
+  write_to_slip((uint8_t *)"?B", 2);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -1126,9 +1202,8 @@ printf("AFTER 120 SECOND\n\n");
     number++;
   }
 
-    howManyRoutes();
-    sendingTo = sendingTo + 1;
-    startChChange(sendingTo);
+    buildChannelAssignment();
+    rolloutStart();
     //process_post_synch(&chChange_process, event_data_ready, NULL);
 
 //  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
@@ -1156,70 +1231,30 @@ simple_udp_sendto(&unicast_connection, &msg2, sizeof(msg2) + 1, &sendTo1);
 PROCESS_THREAD(chChange_process, ev, data)
 {
   static struct etimer time;
-  struct unicast_message *msg;
-  struct unicast_message msg2;
-  msg = data;
-
-  uint8_t randomNewCh;
-  static uip_ds6_route_t *r;
-
-  static uip_ds6_nbr_t *nbr;
-  static uip_ds6_route_t *re;
-
-uint8_t i = 0;
-uint8_t prevRand;
-
-uint8_t wTime;
-//uint8_t x = 0;
 
   PROCESS_BEGIN();
 
-  while(1) {
-    PROCESS_WAIT_EVENT_UNTIL(ev == event_data_ready);
-
-    //3 sec per nbr
-    //equals to 30 secs? (even though it's supposed to be 3 secs) - depends on how many nbr
-    //10 = 60; 5 = 6*5 = 10-30?
-    //etimer_set(&time, 10 * CLOCK_SECOND); //1 min
-//    etimer_set(&time, 3 * CLOCK_SECOND);
-
- //  etimer_set(&time, 5 * CLOCK_SECOND);
-
-//    etimer_set(&time, 10 * CLOCK_SECOND);
-
-//+etimer_set(&time, 40 * CLOCK_SECOND); //simulation
-//+etimer_set(&time, 80 * CLOCK_SECOND); //real hardware
-//etimer_set(&time, 120 * CLOCK_SECOND); //real hardware
-etimer_set(&time, 360 * CLOCK_SECOND); //real hardware
-//£etimer_set(&time, 60 * CLOCK_SECOND); //real hardware
-
-//16 INTERFERENCE USE 70
-//    etimer_set(&time, 70 * CLOCK_SECOND);
-    PROCESS_YIELD_UNTIL(etimer_expired(&time));
-
-/*etimer_set(&time, 1 * CLOCK_SECOND);
-while(wTime == 0 || x <= 5) {
-x++;
-wTime = waitingTime(&holdAddr);
-printf("IN WHILE WTIME %d X %d\n\n", wTime, x);
-//etimer_set(&time, 1 * CLOCK_SECOND);
-PROCESS_YIELD_UNTIL(etimer_expired(&time));
-etimer_reset(&time);
-}
-x = 0;*/
- //   printf("RECHECK for ");
- //   uip_debug_ipaddr_print(&holdAddr);
- //   printf("\n\n");
-
-
+  //the LPBR only follows its neighbours' switches, there is no outcome
+  //to act on
+  channel_switch_init(&chChange_process);
 
- //   recheck(&holdAddr);
-
-    sendingTo = sendingTo + 1;
-    //noOfRetransmit = 0;
-    startChChange(sendingTo);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == event_data_ready && rollout.running);
+
+    while(rolloutNextWave() > 0) {
+      //advance on the last CONFIRM_CH, the timer only bounds a lost one
+      etimer_set(&time, WAVE_TIMEOUT);
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&time) ||
+                               (ev == event_data_ready &&
+                                rollout.waveConfirmed + rollout.waveAborted ==
+                                rollout.waveSize));
+      etimer_stop(&time);
+      rolloutEndWave();
+    }
 
-//etimer_reset(&time);
+    rollout.running = 0;
+    rollout.duration = clock_time() - rollout.started;
+    border_router_print_rollout();
   }
   PROCESS_END();
 }
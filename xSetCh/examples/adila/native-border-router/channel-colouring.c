@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Two-hop channel colouring for the LPBR
+ */
+
+#include "contiki.h"
+#include "net/uip.h"
+#include "net/channel-estimator.h"
+#include "net/mac/spectrum-survey.h"
+#include "channel-colouring.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define DEBUG DEBUG_NONE
+#include "net/uip-debug.h"
+
+#define NUM_CHANNELS (CHANNEL_COLOURING_LAST_CHANNEL - \
+                      CHANNEL_COLOURING_FIRST_CHANNEL + 1)
+#define ROW_BYTES ((CHANNEL_COLOURING_MAX_NODES + 7) / 8)
+
+/* NBRPROBE messages behind each rx value in a probe result */
+#ifdef CHANNEL_COLOURING_CONF_PROBES
+#define PROBES CHANNEL_COLOURING_CONF_PROBES
+#else
+#define PROBES 8
+#endif
+
+struct vertex {
+  uip_ipaddr_t addr;
+  uint32_t saturation;
+  struct channel_estimate estimates[CHANNEL_ESTIMATOR_NUM_CHANNELS];
+  uint8_t occupancy[SPECTRUM_SURVEY_NUM_CHANNELS];
+  uint8_t current;
+  uint8_t channel;
+  uint8_t fixed;
+  uint8_t degree;
+};
+
+static struct vertex vertices[CHANNEL_COLOURING_MAX_NODES];
+static uint8_t links[CHANNEL_COLOURING_MAX_NODES][ROW_BYTES];
+static uint8_t conflicts[CHANNEL_COLOURING_MAX_NODES][ROW_BYTES];
+static int num_vertices;
+static uint16_t channel_use[NUM_CHANNELS];
+
+#define BIT_SET(row, n) ((row)[(n) >> 3] |= 1 << ((n) & 7))
+#define BIT_GET(row, n) ((row)[(n) >> 3] & (1 << ((n) & 7)))
+#define CHANNEL_BIT(ch) ((uint32_t)1 << (ch))
+/*---------------------------------------------------------------------------*/
+/* Link-local and global addresses of a node share the interface
+   identifier, so vertices are matched on the lower 64 bits only. */
+static int
+find_vertex(const uip_ipaddr_t *addr)
+{
+  int v;
+
+  for(v = 0; v < num_vertices; v++) {
+    if(memcmp(&vertices[v].addr.u8[8], &addr->u8[8], 8) == 0) {
+      return v;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+add_vertex(const uip_ipaddr_t *addr)
+{
+  int v, c;
+
+  v = find_vertex(addr);
+  if(v >= 0) {
+    return v;
+  }
+  if(num_vertices == CHANNEL_COLOURING_MAX_NODES) {
+    PRINTF("channel-colouring: graph full\n");
+    return -1;
+  }
+  v = num_vertices++;
+  memset(&vertices[v], 0, sizeof(struct vertex));
+  uip_ipaddr_copy(&vertices[v].addr, addr);
+  for(c = 0; c < CHANNEL_ESTIMATOR_NUM_CHANNELS; c++) {
+    channel_estimate_init(&vertices[v].estimates[c]);
+  }
+  return v;
+}
+/*---------------------------------------------------------------------------*/
+static int
+popcount(uint32_t x)
+{
+  int n;
+
+  for(n = 0; x != 0; n++) {
+    x &= x - 1;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Link quality from the probes, less the share of time the node's
+   survey found the channel busy */
+static int
+quality(const struct vertex *vx, uint8_t channel)
+{
+  int q;
+
+  if(channel < CHANNEL_ESTIMATOR_FIRST_CHANNEL ||
+     channel > CHANNEL_ESTIMATOR_LAST_CHANNEL) {
+    return 0;
+  }
+  q = channel_estimate_score(
+    &vx->estimates[channel - CHANNEL_ESTIMATOR_FIRST_CHANNEL]);
+  q -= vx->occupancy[channel - SPECTRUM_SURVEY_FIRST_CHANNEL] * 16;
+  return q < 0 ? 0 : q;
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_colouring_reset(void)
+{
+  num_vertices = 0;
+  memset(links, 0, sizeof(links));
+  memset(channel_use, 0, sizeof(channel_use));
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_colouring_add_node(const uip_ipaddr_t *addr, uint8_t current)
+{
+  int v;
+
+  v = add_vertex(addr);
+  if(v >= 0 && !vertices[v].fixed) {
+    vertices[v].current = current;
+  }
+  return v;
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_colouring_add_fixed(const uip_ipaddr_t *addr, uint8_t channel)
+{
+  int v;
+
+  v = add_vertex(addr);
+  if(v >= 0) {
+    vertices[v].fixed = 1;
+    vertices[v].current = channel;
+  }
+  return v;
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_colouring_add_link(const uip_ipaddr_t *a, const uip_ipaddr_t *b)
+{
+  int va, vb;
+
+  va = add_vertex(a);
+  vb = add_vertex(b);
+  if(va < 0 || vb < 0 || va == vb) {
+    return;
+  }
+  BIT_SET(links[va], vb);
+  BIT_SET(links[vb], va);
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_colouring_add_quality(const uip_ipaddr_t *addr, uint8_t channel,
+                              uint8_t rx)
+{
+  int v;
+
+  if(channel < CHANNEL_ESTIMATOR_FIRST_CHANNEL ||
+     channel > CHANNEL_ESTIMATOR_LAST_CHANNEL) {
+    return;
+  }
+  v = add_vertex(addr);
+  if(v < 0) {
+    return;
+  }
+  channel_estimate_probe(
+    &vertices[v].estimates[channel - CHANNEL_ESTIMATOR_FIRST_CHANNEL],
+    rx, PROBES);
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_colouring_add_survey(const uip_ipaddr_t *addr, const uint8_t *report)
+{
+  int v;
+  uint8_t ch;
+
+  v = add_vertex(addr);
+  if(v < 0) {
+    return;
+  }
+  for(ch = SPECTRUM_SURVEY_FIRST_CHANNEL;
+      ch <= SPECTRUM_SURVEY_LAST_CHANNEL; ch++) {
+    vertices[v].occupancy[ch - SPECTRUM_SURVEY_FIRST_CHANNEL] =
+      SPECTRUM_SURVEY_REPORT_OCCUPANCY(report, ch);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Two nodes conflict when they are neighbours or share a neighbour. */
+static void
+build_conflicts(void)
+{
+  int v, u, b;
+
+  memset(conflicts, 0, sizeof(conflicts));
+  for(v = 0; v < num_vertices; v++) {
+    for(u = 0; u < num_vertices; u++) {
+      if(BIT_GET(links[v], u)) {
+        for(b = 0; b < ROW_BYTES; b++) {
+          conflicts[v][b] |= links[v][b] | links[u][b];
+        }
+      }
+    }
+    conflicts[v][v >> 3] &= ~(1 << (v & 7));
+  }
+
+  for(v = 0; v < num_vertices; v++) {
+    vertices[v].degree = 0;
+    for(u = 0; u < num_vertices; u++) {
+      if(BIT_GET(conflicts[v], u)) {
+        vertices[v].degree++;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+colour(int v, uint8_t channel)
+{
+  int u;
+
+  vertices[v].channel = channel;
+  if(channel >= CHANNEL_COLOURING_FIRST_CHANNEL &&
+     channel <= CHANNEL_COLOURING_LAST_CHANNEL) {
+    channel_use[channel - CHANNEL_COLOURING_FIRST_CHANNEL]++;
+  }
+  for(u = 0; u < num_vertices; u++) {
+    if(BIT_GET(conflicts[v], u)) {
+      vertices[u].saturation |= CHANNEL_BIT(channel);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Uncoloured vertex with the most distinct channels around it; ties go
+   to the larger two-hop neighbourhood, then to the lower address. */
+static int
+next_vertex(void)
+{
+  int v, best, sat, best_sat;
+
+  best = -1;
+  best_sat = -1;
+  for(v = 0; v < num_vertices; v++) {
+    if(vertices[v].channel != CHANNEL_COLOURING_NONE) {
+      continue;
+    }
+    sat = popcount(vertices[v].saturation);
+    if(best < 0 || sat > best_sat ||
+       (sat == best_sat && vertices[v].degree > vertices[best].degree) ||
+       (sat == best_sat && vertices[v].degree == vertices[best].degree &&
+        memcmp(&vertices[v].addr.u8[8], &vertices[best].addr.u8[8], 8) < 0)) {
+      best = v;
+      best_sat = sat;
+    }
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+/* Count of two-hop neighbours already on channel. */
+static int
+clashes(int v, uint8_t channel)
+{
+  int u, n;
+
+  n = 0;
+  for(u = 0; u < num_vertices; u++) {
+    if(BIT_GET(conflicts[v], u) && vertices[u].channel == channel) {
+      n++;
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Pick the free channel with the best measured quality, keeping the
+   current channel and then the least used one on ties. When every
+   channel is taken within two hops, take the one with fewest clashes. */
+static uint8_t
+choose_channel(int v, int *clash_count)
+{
+  struct vertex *vx;
+  uint8_t ch, best;
+  int q, best_q, c, best_c, is_free, best_free;
+
+  vx = &vertices[v];
+  best = CHANNEL_COLOURING_NONE;
+  best_q = best_c = 0;
+  best_free = 0;
+  for(ch = CHANNEL_COLOURING_FIRST_CHANNEL;
+      ch <= CHANNEL_COLOURING_LAST_CHANNEL; ch++) {
+    is_free = (vx->saturation & CHANNEL_BIT(ch)) == 0;
+    if(best_free && !is_free) {
+      continue;
+    }
+    c = is_free ? 0 : clashes(v, ch);
+    q = quality(vx, ch);
+    if(best == CHANNEL_COLOURING_NONE ||
+       (is_free && !best_free) ||
+       c < best_c ||
+       (c == best_c && q > best_q) ||
+       (c == best_c && q == best_q && ch == vx->current) ||
+       (c == best_c && q == best_q && best != vx->current &&
+        channel_use[ch - CHANNEL_COLOURING_FIRST_CHANNEL] <
+        channel_use[best - CHANNEL_COLOURING_FIRST_CHANNEL])) {
+      best = ch;
+      best_q = q;
+      best_c = c;
+      best_free = is_free;
+    }
+  }
+  *clash_count = best_c;
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_colouring_run(void)
+{
+  int v, clash_count, unresolved;
+
+  build_conflicts();
+
+  for(v = 0; v < num_vertices; v++) {
+    vertices[v].channel = CHANNEL_COLOURING_NONE;
+    vertices[v].saturation = 0;
+  }
+  memset(channel_use, 0, sizeof(channel_use));
+  for(v = 0; v < num_vertices; v++) {
+    if(vertices[v].fixed) {
+      colour(v, vertices[v].current);
+    }
+  }
+
+  unresolved = 0;
+  while((v = next_vertex()) >= 0) {
+    colour(v, choose_channel(v, &clash_count));
+    if(clash_count > 0) {
+      unresolved++;
+    }
+  }
+
+  PRINTF("channel-colouring: %d nodes, %d unresolved\n",
+         num_vertices, unresolved);
+  return unresolved;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+channel_colouring_get(const uip_ipaddr_t *addr)
+{
+  int v;
+
+  v = find_vertex(addr);
+  if(v < 0) {
+    return CHANNEL_COLOURING_NONE;
+  }
+  return vertices[v].channel;
+}
+/*---------------------------------------------------------------------------*/
+/* The vertices within two hops of v, not counting paths through the
+   fixed vertices: the LPBR keeps its channel, so nodes that only meet
+   at the LPBR can switch together. */
+static void
+reach_without_fixed(int v, uint8_t *row)
+{
+  int u, i;
+
+  memcpy(row, links[v], ROW_BYTES);
+  for(u = 0; u < num_vertices; u++) {
+    if(BIT_GET(links[v], u) && !vertices[u].fixed) {
+      for(i = 0; i < ROW_BYTES; i++) {
+        row[i] |= links[u][i];
+      }
+    }
+  }
+  for(u = 0; u < num_vertices; u++) {
+    if(vertices[u].fixed) {
+      row[u >> 3] &= ~(1 << (u & 7));
+    }
+  }
+  row[v >> 3] &= ~(1 << (v & 7));
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_colouring_independent(const uip_ipaddr_t *a, const uip_ipaddr_t *b)
+{
+  uint8_t ra[ROW_BYTES], rb[ROW_BYTES];
+  int va, vb, i;
+
+  va = find_vertex(a);
+  vb = find_vertex(b);
+  if(va < 0 || vb < 0 || va == vb) {
+    return 0;
+  }
+  reach_without_fixed(va, ra);
+  reach_without_fixed(vb, rb);
+  if(BIT_GET(ra, vb)) {
+    return 0;
+  }
+  for(i = 0; i < ROW_BYTES; i++) {
+    if(ra[i] & rb[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_colouring_print(void)
+{
+  int v;
+
+  printf("CHANNEL ASSIGNMENT\n");
+  for(v = 0; v < num_vertices; v++) {
+    uip_debug_ipaddr_print(&vertices[v].addr);
+    printf("\t%d -> %d%s\n", vertices[v].current, vertices[v].channel,
+           vertices[v].fixed ? " (fixed)" : "");
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Two-hop channel colouring for the LPBR. The border router feeds
+ *         the links it has learned (SEND_NBR reports, probe results and
+ *         its own neighbour table) into a conflict graph and colours it
+ *         in one pass with a DSATUR heuristic, preferring the channels
+ *         on which each node measured the best probe reception.
+ */
+
+#ifndef __CHANNEL_COLOURING_H__
+#define __CHANNEL_COLOURING_H__
+
+#include "contiki.h"
+#include "net/uip.h"
+
+#ifdef CHANNEL_COLOURING_CONF_MAX_NODES
+#define CHANNEL_COLOURING_MAX_NODES CHANNEL_COLOURING_CONF_MAX_NODES
+#else
+#define CHANNEL_COLOURING_MAX_NODES 128
+#endif
+
+/* Channel range handed out by the colouring, inclusive. */
+#ifdef CHANNEL_COLOURING_CONF_FIRST_CHANNEL
+#define CHANNEL_COLOURING_FIRST_CHANNEL CHANNEL_COLOURING_CONF_FIRST_CHANNEL
+#else
+#define CHANNEL_COLOURING_FIRST_CHANNEL 11
+#endif
+
+#ifdef CHANNEL_COLOURING_CONF_LAST_CHANNEL
+#define CHANNEL_COLOURING_LAST_CHANNEL CHANNEL_COLOURING_CONF_LAST_CHANNEL
+#else
+#define CHANNEL_COLOURING_LAST_CHANNEL 26
+#endif
+
+#define CHANNEL_COLOURING_NONE 0
+
+/* Empty the graph before it is rebuilt from the LPBR tables. */
+void channel_colouring_reset(void);
+
+/* Add a node that needs a channel; current is the channel it is on now. */
+int channel_colouring_add_node(const uip_ipaddr_t *addr, uint8_t current);
+
+/* Add a node whose channel must not change (the LPBR itself). */
+int channel_colouring_add_fixed(const uip_ipaddr_t *addr, uint8_t channel);
+
+/* Record that a and b hear each other. Unknown nodes are added. */
+void channel_colouring_add_link(const uip_ipaddr_t *a, const uip_ipaddr_t *b);
+
+/* Record rx probes received by addr on channel. */
+void channel_colouring_add_quality(const uip_ipaddr_t *addr, uint8_t channel,
+                                   uint8_t rx);
+
+/* Record a packed spectrum survey (net/mac/spectrum-survey.h) taken by
+   addr; busy channels then rank below quiet ones for that node. */
+void channel_colouring_add_survey(const uip_ipaddr_t *addr,
+                                  const uint8_t *report);
+
+/* Colour the graph. Returns the number of nodes that could not be given
+   a channel free within two hops. */
+int channel_colouring_run(void);
+
+/* Channel assigned to addr by the last run, or CHANNEL_COLOURING_NONE. */
+uint8_t channel_colouring_get(const uip_ipaddr_t *addr);
+
+/* Non-zero when a and b are both in the graph and their two-hop
+   neighbourhoods do not overlap, so they can change channel together.
+   Paths through fixed vertices (the LPBR) do not count. */
+int channel_colouring_independent(const uip_ipaddr_t *a,
+                                  const uip_ipaddr_t *b);
+
+void channel_colouring_print(void);
+
+#endif /* __CHANNEL_COLOURING_H__ */
@@ -54,6 +54,12 @@
 #undef NETSTACK_CONF_RDC
 #define NETSTACK_CONF_RDC border_router_rdc_driver
 
+/* serve the netstack before the test and command processes */
+#define PROCESS_CONF_PRIORITY 1
+
+/* index the routing table, the root routes for the whole network */
+#define UIP_DS6_ROUTE_CONF_INDEX 1
+
 /* used by wpcap (see /cpu/native/net/wpcap-drv.c) */
 #define SELECT_CALLBACK 1
 
@@ -283,8 +283,17 @@ serial_input(FILE *inslip)
   goto read_more;
 }
 
-unsigned char slip_buf[2048];
-int slip_end, slip_begin, slip_packet_end, slip_packet_count;
+/* Outgoing SLIP data is kept in a ring. slip_ready counts the queued
+   bytes that end with a complete packet, so that a write never sends a
+   packet that is still being encoded. */
+#ifdef SLIP_DEV_CONF_BUF_SIZE
+#define SLIP_BUF_SIZE SLIP_DEV_CONF_BUF_SIZE
+#else
+#define SLIP_BUF_SIZE 2048
+#endif
+
+static unsigned char slip_buf[SLIP_BUF_SIZE];
+static int slip_begin, slip_end, slip_used, slip_ready;
 static struct timer send_delay_timer;
 /* delay between slip packets */
 static clock_time_t send_delay = SEND_DELAY;
@@ -292,65 +301,68 @@ static clock_time_t send_delay = SEND_DELAY;
 static void
 slip_send(int fd, unsigned char c)
 {
-  if(slip_end >= sizeof(slip_buf)) {
+  if(slip_used >= sizeof(slip_buf)) {
     err(1, "slip_send overflow");
   }
   slip_buf[slip_end] = c;
-  slip_end++;
+  slip_end = (slip_end + 1) % sizeof(slip_buf);
+  slip_used++;
   slip_sent++;
   if(c == SLIP_END) {
     /* Full packet received. */
-    slip_packet_count++;
-    if(slip_packet_end == 0) {
-      slip_packet_end = slip_end;
-    }
+    slip_ready = slip_used;
   }
 }
 /*---------------------------------------------------------------------------*/
 int
 slip_empty()
 {
-  return slip_packet_end == 0;
+  return slip_ready == 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+first_packet_length(void)
+{
+  int i;
+
+  for(i = 0; i < slip_ready; i++) {
+    if(slip_buf[(slip_begin + i) % sizeof(slip_buf)] == SLIP_END) {
+      return i + 1;
+    }
+  }
+  return slip_ready;
 }
 /*---------------------------------------------------------------------------*/
 void
 slip_flushbuf(int fd)
 {
-  int n;
+  int n, len, packet_len;
 
   if(slip_empty()) {
     return;
   }
 
-  n = write(fd, slip_buf + slip_begin, slip_packet_end - slip_begin);
+  /* Without a delay between packets, all complete packets go in one
+     write, up to where the ring wraps */
+  packet_len = first_packet_length();
+  len = send_delay > 0 ? packet_len : slip_ready;
+  if(slip_begin + len > sizeof(slip_buf)) {
+    len = sizeof(slip_buf) - slip_begin;
+  }
+
+  n = write(fd, slip_buf + slip_begin, len);
 
   if(n == -1 && errno != EAGAIN) {
     err(1, "slip_flushbuf write failed");
   } else if(n == -1) {
     PROGRESS("Q");		/* Outqueue is full! */
   } else {
-    slip_begin += n;
-    if(slip_begin == slip_packet_end) {
-      slip_packet_count--;
-      if(slip_end > slip_packet_end) {
-        memcpy(slip_buf, slip_buf + slip_packet_end,
-               slip_end - slip_packet_end);
-      }
-      slip_end -= slip_packet_end;
-      slip_begin = slip_packet_end = 0;
-      if(slip_end > 0) {
-        /* Find end of next slip packet */
-        for(n = 1; n < slip_end; n++) {
-          if(slip_buf[n] == SLIP_END) {
-            slip_packet_end = n + 1;
-            break;
-          }
-        }
-        /* a delay between slip packets to avoid losing data */
-        if(send_delay > 0) {
-          timer_set(&send_delay_timer, send_delay);
-        }
-      }
+    slip_begin = (slip_begin + n) % sizeof(slip_buf);
+    slip_used -= n;
+    slip_ready -= n;
+    /* a delay between slip packets to avoid losing data */
+    if(send_delay > 0 && n == packet_len && slip_ready > 0) {
+      timer_set(&send_delay_timer, send_delay);
     }
   }
 }
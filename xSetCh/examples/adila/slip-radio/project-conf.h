@@ -33,8 +33,9 @@
 #undef QUEUEBUF_CONF_NUM
 #define QUEUEBUF_CONF_NUM          4
 
+/* Room for a '!B' batch of several frames from the border router */
 #undef UIP_CONF_BUFFER_SIZE
-#define UIP_CONF_BUFFER_SIZE    140
+#define UIP_CONF_BUFFER_SIZE    400
 
 #undef UIP_CONF_ROUTER
 #define UIP_CONF_ROUTER                 0
@@ -52,7 +52,8 @@
 
 //ADILA EDIT 25/02/15
 #include "net/mac/contikimac.h"
-#include "net/mac/simplified_nbr_table.h"
+#include "net/mac/nbr-channel.h"
+#include "net/mac/radio-channel.h"
 //-------------------
 
 #ifdef SLIP_RADIO_CONF_SENSORS
@@ -91,7 +92,7 @@ packet_sent(void *ptr, int status, int transmissions)
 
   //ADILA EDIT 10/11/14
   /* Reset to own listening channel after transmitting packet */
-  cc2420_set_channel(uip_ds6_if.addr_list[1].currentCh);
+  radio_channel_set(uip_ds6_if.addr_list[1].currentCh);
 
   /* packet callback from lower layers */
   /*  neighbor_info_packet_sent(status, transmissions); */
@@ -104,62 +105,78 @@ packet_sent(void *ptr, int status, int transmissions)
   cmd_send(buf, pos);
 }
 /*---------------------------------------------------------------------------*/
-static int
-slip_radio_cmd_handler(const uint8_t *data, int len)
+/* Sends one frame of a '!S' or '!B' command. The frame starts with the
+   session id, followed by the channel, two address bytes, the packet
+   attributes and the packet data. */
+static void
+send_frame(const uint8_t *frame, int len)
 {
-  int i;
-  uint8_t setCh = 0;
+  int pos;
 
-  if(data[0] == '!') {
-    /* should send out stuff to the radio - ignore it as IP */
-    /* --- s e n d --- */
-    if(data[1] == 'S') {
-      int pos;
-      packet_ids[packet_pos] = data[2];
+  if(len < 4) {
+    PRINTF("slip-radio: short frame\n");
+    return;
+  }
 
-      //ADILA EDIT 1/12/14
-      /* Checks if channel value (data[3]) passed from border-router-rdc.c is not 0
-	 Checks if the IP and channel are already in the simplified_nbr_table */
-      if(data[3] != 0) {
-	setCh = simplified_check_table(data[4], data[5], data[3]);
-	if(setCh != 1) {
-	  simplified_nbr_table_set_channel(data[4], data[5], data[3]);
-	}
-        cc2420_set_channel(data[3]);
-      }
+  packet_ids[packet_pos] = frame[0];
 
-      packetbuf_clear();
+  packetbuf_clear();
 
-      //ADILA EDIT 01/12/14
-      /* Changed 3 to 6 (buf value) */
-      pos = packetutils_deserialize_atts(&data[6], len - 6);
-      if(pos < 0) {
-        PRINTF("slip-radio: illegal packet attributes\n");
-        return 1;
-      }
-      //ADILA EDIT 01/12/14
-      /* Changed 3 to 6 (buf value) */
-      pos += 6;
-      len -= pos;
+  //ADILA EDIT 01/12/14
+  /* Changed 3 to 6 (buf value) */
+  pos = packetutils_deserialize_atts(&frame[4], len - 4);
+  if(pos < 0) {
+    PRINTF("slip-radio: illegal packet attributes\n");
+    return;
+  }
+  //ADILA EDIT 01/12/14
+  /* Changed 3 to 6 (buf value) */
+  pos += 4;
+  len -= pos;
 
-      if(len > PACKETBUF_SIZE) {
-        len = PACKETBUF_SIZE;
-      }
-      memcpy(packetbuf_dataptr(), &data[pos], len);
-      packetbuf_set_datalen(len);
+  if(len > PACKETBUF_SIZE) {
+    len = PACKETBUF_SIZE;
+  }
+  memcpy(packetbuf_dataptr(), &frame[pos], len);
+  packetbuf_set_datalen(len);
 
-      PRINTF("slip-radio: sending %u (%d bytes)\n",
-             data[2], packetbuf_datalen());
+  PRINTF("slip-radio: sending %u (%d bytes)\n",
+         frame[0], packetbuf_datalen());
 
-      /* parse frame before sending to get addresses, etc. */
-      no_framer.parse();
-      NETSTACK_MAC.send(packet_sent, &packet_ids[packet_pos]);
+  /* parse frame before sending to get addresses, etc. */
+  no_framer.parse();
 
-      packet_pos++;
-      if(packet_pos >= sizeof(packet_ids)) {
-	packet_pos = 0;
-      }
+  /* The channel value (frame[1]) passed from border-router-rdc.c is
+     kept against the receiver's link-layer address, where the RDC
+     layer looks it up when transmitting */
+  if(frame[1] != 0) {
+    nbr_channel_set(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), frame[1]);
+  }
 
+  NETSTACK_MAC.send(packet_sent, &packet_ids[packet_pos]);
+
+  packet_pos++;
+  if(packet_pos >= sizeof(packet_ids)) {
+    packet_pos = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+slip_radio_cmd_handler(const uint8_t *data, int len)
+{
+  int i;
+
+  if(data[0] == '!') {
+    /* should send out stuff to the radio - ignore it as IP */
+    /* --- s e n d --- */
+    if(data[1] == 'S') {
+      send_frame(&data[2], len - 2);
+      return 1;
+    } else if(data[1] == 'B') {
+      /* A batch of frames, each after its length byte */
+      for(i = 2; i < len && i + 1 + data[i] <= len; i += 1 + data[i]) {
+        send_frame(&data[i + 1], data[i]);
+      }
       return 1;
     }
   } else if(uip_buf[0] == '?') {
@@ -174,6 +191,15 @@ slip_radio_cmd_handler(const uint8_t *data, int len)
       uip_len = 10;
       cmd_send(uip_buf, uip_len);
       return 1;
+    } else if(data[1] == 'B') {
+      /* Tell the border router how large a batch fits in uip_buf */
+      uip_buf[0] = '!';
+      uip_buf[1] = 'B';
+      uip_buf[2] = (UIP_BUFSIZE - UIP_LLH_LEN) >> 8;
+      uip_buf[3] = (UIP_BUFSIZE - UIP_LLH_LEN) & 0xff;
+      uip_len = 4;
+      cmd_send(uip_buf, uip_len);
+      return 1;
     }
   }
   return 0;
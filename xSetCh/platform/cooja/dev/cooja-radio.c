@@ -74,6 +74,19 @@ radio_set_channel(int channel)
   simRadioChannel = channel;
 }
 /*---------------------------------------------------------------------------*/
+static int
+set_channel(int channel)
+{
+  radio_set_channel(channel);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+get_channel(void)
+{
+  return simRadioChannel;
+}
+/*---------------------------------------------------------------------------*/
 void
 radio_set_txpower(unsigned char power)
 {
@@ -274,6 +287,8 @@ const struct radio_driver cooja_radio_driver =
     pending_packet,
     radio_on,
     radio_off,
+    set_channel,
+    get_channel,
 };
 /*---------------------------------------------------------------------------*/
 SIM_INTERFACE(radio_interface,